@@ -0,0 +1,573 @@
+#include <frt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Micro benchmarks of the frt wrapper on the FreeRTOS POSIX port.
+//
+// Each benchmark prints one JSON object per line to stdout, so the
+// output can be collected and compared between revisions. Set
+// FRT_BENCH_ITERATIONS to override the default iteration count.
+
+namespace
+{
+
+	const unsigned int bench_stack_size = configMINIMAL_STACK_SIZE * sizeof(StackType_t);
+	const unsigned char bench_priority = 2;
+	const unsigned int batch_size = 16;
+	const unsigned long max_sleep_iterations = 1000;
+
+	unsigned long iterations = 100000;
+
+	uint64_t nowNs()
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+	}
+
+	void report(const char* name, unsigned int item_size, unsigned long ops, uint64_t elapsed_ns)
+	{
+		printf("{\"benchmark\":\"%s\",", name);
+		if (item_size) {
+			printf("\"item_size\":%u,", item_size);
+		}
+		printf(
+			"\"iterations\":%lu,\"total_ns\":%llu,\"ns_per_op\":%.1f}\n",
+			ops,
+			static_cast<unsigned long long>(elapsed_ns),
+			static_cast<double>(elapsed_ns) / ops
+		);
+		fflush(stdout);
+	}
+
+	template<unsigned int SIZE>
+	struct Item {
+		uint8_t data[SIZE];
+	};
+
+	// Task notification ping-pong partner
+	void postRunner();
+
+	class NotifyPongTask final :
+		public frt::Task<NotifyPongTask, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			if (wait(10)) {
+				postRunner();
+			}
+
+			return true;
+		}
+	};
+
+	NotifyPongTask notify_pong_task;
+
+	// Trivial run() loop, measures the per iteration overhead of Task.
+	// With CRITICAL_READ, run() also reads a stop flag inside a critical
+	// section, like entryPoint() did before it switched to an atomic
+	// load, so the difference shows what that saved.
+	template<bool CRITICAL_READ>
+	class TrivialRunTask final :
+		public frt::Task<TrivialRunTask<CRITICAL_READ>, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			if (CRITICAL_READ) {
+				taskENTER_CRITICAL();
+				const bool stop = do_stop;
+				taskEXIT_CRITICAL();
+
+				if (stop) {
+					return false;
+				}
+			}
+
+			if (++count < iterations) {
+				return true;
+			}
+
+			postRunner();
+
+			return false;
+		}
+
+		unsigned long count = 0;
+		volatile bool do_stop = false;
+	};
+
+	TrivialRunTask<false> trivial_run_task;
+	TrivialRunTask<true> critical_run_task;
+
+	// Semaphore ping-pong partner
+	frt::Semaphore ping_semaphore;
+	frt::Semaphore pong_semaphore;
+
+	class SemaphorePongTask final :
+		public frt::Task<SemaphorePongTask, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			if (ping_semaphore.wait(10)) {
+				pong_semaphore.post();
+			}
+
+			return true;
+		}
+	};
+
+	SemaphorePongTask semaphore_pong_task;
+
+	// Mutex contender, hands the lock back and forth with the runner
+	frt::Mutex mutex;
+
+	class MutexContenderTask final :
+		public frt::Task<MutexContenderTask, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			mutex.lock();
+			yield();
+			mutex.unlock();
+			yield();
+
+			return true;
+		}
+	};
+
+	MutexContenderTask mutex_contender_task;
+
+	// Queue producer, streams a fixed number of items to the runner
+	template<unsigned int SIZE>
+	class QueueProducerTask final :
+		public frt::Task<QueueProducerTask<SIZE>, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			const Item<SIZE> item = {};
+
+			for (unsigned long i = 0; i < iterations; ++i) {
+				queue.push(item);
+			}
+
+			return false;
+		}
+
+		frt::Queue<Item<SIZE>, 16> queue;
+	};
+
+	QueueProducerTask<4> queue_producer_task_4;
+	QueueProducerTask<32> queue_producer_task_32;
+	QueueProducerTask<256> queue_producer_task_256;
+
+	// Queue producer using pushMany(), paired with popMany() in the runner
+	template<unsigned int SIZE>
+	class BatchQueueProducerTask final :
+		public frt::Task<BatchQueueProducerTask<SIZE>, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			const Item<SIZE> items[batch_size] = {};
+
+			for (unsigned long pushed = 0; pushed < iterations;) {
+				const unsigned long left = iterations - pushed;
+				pushed += queue.pushMany(items, left < batch_size ? left : batch_size);
+			}
+
+			return false;
+		}
+
+		frt::Queue<Item<SIZE>, batch_size> queue;
+	};
+
+	BatchQueueProducerTask<4> batch_queue_producer_task_4;
+	BatchQueueProducerTask<32> batch_queue_producer_task_32;
+	BatchQueueProducerTask<256> batch_queue_producer_task_256;
+
+	// SpscRing producer, the same for the lock-free ring
+	template<unsigned int SIZE>
+	class RingProducerTask final :
+		public frt::Task<RingProducerTask<SIZE>, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			const Item<SIZE> item = {};
+
+			for (unsigned long i = 0; i < iterations; ++i) {
+				while (!ring.push(item)) {
+					this->yield();
+				}
+			}
+
+			return false;
+		}
+
+		frt::SpscRing<Item<SIZE>, 16> ring;
+	};
+
+	RingProducerTask<4> ring_producer_task_4;
+	RingProducerTask<32> ring_producer_task_32;
+	RingProducerTask<256> ring_producer_task_256;
+
+	// Byte stream producers, one byte per Queue push versus chunks into a StreamBuffer
+	class ByteQueueProducerTask final :
+		public frt::Task<ByteQueueProducerTask, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			for (unsigned long i = 0; i < iterations; ++i) {
+				queue.push(static_cast<uint8_t>(i));
+			}
+
+			return false;
+		}
+
+		frt::Queue<uint8_t, 64> queue;
+	};
+
+	ByteQueueProducerTask byte_queue_producer_task;
+
+	class StreamBufferProducerTask final :
+		public frt::Task<StreamBufferProducerTask, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			const uint8_t chunk[batch_size] = {};
+
+			for (unsigned long written = 0; written < iterations;) {
+				const unsigned long left = iterations - written;
+				written += stream_buffer.write(chunk, left < batch_size ? left : batch_size);
+			}
+
+			return false;
+		}
+
+		frt::StreamBuffer<64> stream_buffer;
+	};
+
+	StreamBufferProducerTask stream_buffer_producer_task;
+
+	class BenchRunnerTask final :
+		public frt::Task<BenchRunnerTask, bench_stack_size>
+	{
+	public:
+		bool run()
+		{
+			benchTaskRunLoop();
+			benchTaskSleep();
+			benchNotifyPingPong();
+			benchSemaphorePingPong();
+			benchMutexUncontended();
+			benchMutexContended();
+			benchQueuePushPop<4>();
+			benchQueuePushPop<32>();
+			benchQueuePushPop<256>();
+			benchQueueStream(queue_producer_task_4);
+			benchQueueStream(queue_producer_task_32);
+			benchQueueStream(queue_producer_task_256);
+			benchQueueStreamBatch(batch_queue_producer_task_4);
+			benchQueueStreamBatch(batch_queue_producer_task_32);
+			benchQueueStreamBatch(batch_queue_producer_task_256);
+			benchZeroCopyPushPop<4>();
+			benchZeroCopyPushPop<32>();
+			benchZeroCopyPushPop<256>();
+			benchRingPushPop<4>();
+			benchRingPushPop<32>();
+			benchRingPushPop<256>();
+			benchRingStream(ring_producer_task_4);
+			benchRingStream(ring_producer_task_32);
+			benchRingStream(ring_producer_task_256);
+			benchPoolAllocFree<4>();
+			benchPoolAllocFree<32>();
+			benchPoolAllocFree<256>();
+			benchByteQueueStream();
+			benchStreamBufferStream();
+
+			exit(EXIT_SUCCESS);
+
+			return false;
+		}
+
+	private:
+		void benchTaskRunLoop()
+		{
+			uint64_t start = nowNs();
+			trivial_run_task.start(bench_priority, "TrivialRun");
+			wait();
+			uint64_t elapsed = nowNs() - start;
+
+			report("task_run_loop", 0, iterations, elapsed);
+
+			start = nowNs();
+			critical_run_task.start(bench_priority, "CriticalRun");
+			wait();
+			elapsed = nowNs() - start;
+
+			report("task_run_loop_critical_reference", 0, iterations, elapsed);
+		}
+
+		void benchTaskSleep()
+		{
+			// Sleeping takes real time, so keep the number of rounds low
+			const unsigned long rounds = iterations < max_sleep_iterations ? iterations : max_sleep_iterations;
+
+			uint64_t start = nowNs();
+			for (unsigned long i = 0; i < rounds; ++i) {
+				msleep(1);
+			}
+			uint64_t elapsed = nowNs() - start;
+
+			report("task_msleep_1ms", 0, rounds, elapsed);
+
+#if FRT_HIGH_RES_TIMER > 0
+			start = nowNs();
+			for (unsigned long i = 0; i < rounds; ++i) {
+				usleep(100);
+			}
+			elapsed = nowNs() - start;
+
+			report("task_usleep_100us", 0, rounds, elapsed);
+#endif
+		}
+
+		void benchNotifyPingPong()
+		{
+			notify_pong_task.start(bench_priority, "NotifyPong");
+
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				notify_pong_task.post();
+				wait();
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			notify_pong_task.stop();
+
+			report("task_notify_pingpong", 0, iterations, elapsed);
+		}
+
+		void benchSemaphorePingPong()
+		{
+			semaphore_pong_task.start(bench_priority, "SemaphorePong");
+
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				ping_semaphore.post();
+				pong_semaphore.wait();
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			semaphore_pong_task.stop();
+
+			report("semaphore_pingpong", 0, iterations, elapsed);
+		}
+
+		void benchMutexUncontended()
+		{
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				mutex.lock();
+				mutex.unlock();
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("mutex_lock_unlock_uncontended", 0, iterations, elapsed);
+		}
+
+		void benchMutexContended()
+		{
+			mutex_contender_task.start(bench_priority, "MutexContender");
+
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				mutex.lock();
+				yield();
+				mutex.unlock();
+				yield();
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			mutex_contender_task.stop();
+
+			report("mutex_lock_unlock_contended", 0, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchQueuePushPop()
+		{
+			static frt::Queue<Item<SIZE>, 16> queue;
+			Item<SIZE> item = {};
+
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				queue.push(item);
+				queue.pop(item);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("queue_push_pop", SIZE, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchQueueStream(QueueProducerTask<SIZE>& producer)
+		{
+			Item<SIZE> item;
+
+			const uint64_t start = nowNs();
+			producer.start(bench_priority, "QueueProducer");
+			for (unsigned long i = 0; i < iterations; ++i) {
+				producer.queue.pop(item);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("queue_stream", SIZE, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchQueueStreamBatch(BatchQueueProducerTask<SIZE>& producer)
+		{
+			Item<SIZE> items[batch_size];
+
+			const uint64_t start = nowNs();
+			producer.start(bench_priority, "BatchProducer");
+			for (unsigned long popped = 0; popped < iterations;) {
+				popped += producer.queue.popMany(items, batch_size);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("queue_stream_batch", SIZE, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchZeroCopyPushPop()
+		{
+			static frt::ZeroCopyQueue<Item<SIZE>, 16> queue;
+
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				Item<SIZE>* const pushed = queue.beginPush();
+				pushed->data[0] = i;
+				queue.commitPush(pushed);
+
+				const Item<SIZE>* const popped = queue.beginPop();
+				queue.releasePop(popped);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("zero_copy_queue_push_pop", SIZE, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchRingPushPop()
+		{
+			static frt::SpscRing<Item<SIZE>, 16> ring;
+			Item<SIZE> item = {};
+
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				ring.push(item);
+				ring.tryPop(item);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("spsc_ring_push_pop", SIZE, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchRingStream(RingProducerTask<SIZE>& producer)
+		{
+			Item<SIZE> item;
+
+			const uint64_t start = nowNs();
+			producer.start(bench_priority, "RingProducer");
+			for (unsigned long i = 0; i < iterations; ++i) {
+				producer.ring.pop(item);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("spsc_ring_stream", SIZE, iterations, elapsed);
+		}
+
+		template<unsigned int SIZE>
+		void benchPoolAllocFree()
+		{
+			static frt::Pool<Item<SIZE>, 16> pool;
+
+			// Two blocks per round, given back in the order taken, so
+			// the free list head changes on every call
+			const uint64_t start = nowNs();
+			for (unsigned long i = 0; i < iterations; ++i) {
+				Item<SIZE>* const first = pool.alloc();
+				Item<SIZE>* const second = pool.alloc();
+				first->data[0] = i;
+				pool.free(first);
+				pool.free(second);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("pool_alloc_free", SIZE, 2 * iterations, elapsed);
+		}
+
+		void benchByteQueueStream()
+		{
+			uint8_t byte;
+
+			const uint64_t start = nowNs();
+			byte_queue_producer_task.start(bench_priority, "ByteQueueProducer");
+			for (unsigned long i = 0; i < iterations; ++i) {
+				byte_queue_producer_task.queue.pop(byte);
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("byte_queue_stream", 1, iterations, elapsed);
+		}
+
+		void benchStreamBufferStream()
+		{
+			uint8_t chunk[batch_size];
+
+			const uint64_t start = nowNs();
+			stream_buffer_producer_task.start(bench_priority, "StreamProducer");
+			for (unsigned long received = 0; received < iterations;) {
+				received += stream_buffer_producer_task.stream_buffer.read(chunk, sizeof(chunk));
+			}
+			const uint64_t elapsed = nowNs() - start;
+
+			report("stream_buffer_stream", 1, iterations, elapsed);
+		}
+	};
+
+	BenchRunnerTask bench_runner_task;
+
+	void postRunner()
+	{
+		bench_runner_task.post();
+	}
+
+}
+
+void setup()
+{
+	const char* const env_iterations = getenv("FRT_BENCH_ITERATIONS");
+	if (env_iterations && strtoul(env_iterations, nullptr, 10)) {
+		iterations = strtoul(env_iterations, nullptr, 10);
+	}
+
+	bench_runner_task.start(bench_priority, "BenchRunner");
+}
+
+void loop()
+{
+}
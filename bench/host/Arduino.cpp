@@ -0,0 +1,76 @@
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <time.h>
+
+namespace
+{
+
+	uint64_t elapsedMicros()
+	{
+		static timespec start;
+		static bool started = false;
+
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		if (!started) {
+			start = now;
+			started = true;
+		}
+
+		return
+			static_cast<uint64_t>(now.tv_sec - start.tv_sec) * 1000000
+			+ (now.tv_nsec - start.tv_nsec) / 1000;
+	}
+
+}
+
+HostSerial Serial;
+
+unsigned long millis()
+{
+	return elapsedMicros() / 1000;
+}
+
+unsigned long micros()
+{
+	return elapsedMicros();
+}
+
+void HostSerial::begin(unsigned long baud)
+{
+	static_cast<void>(baud);
+}
+
+size_t HostSerial::print(const char* str)
+{
+	return printf("%s", str);
+}
+
+size_t HostSerial::print(char c)
+{
+	return printf("%c", c);
+}
+
+size_t HostSerial::print(long value)
+{
+	return printf("%ld", value);
+}
+
+size_t HostSerial::print(unsigned long value)
+{
+	return printf("%lu", value);
+}
+
+size_t HostSerial::print(double value)
+{
+	return printf("%.2f", value);
+}
+
+size_t HostSerial::println()
+{
+	const size_t res = printf("\r\n");
+	fflush(stdout);
+	return res;
+}
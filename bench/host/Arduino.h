@@ -0,0 +1,59 @@
+#pragma once
+
+// Minimal host replacement for the parts of Arduino.h used by frt and
+// the benchmarks
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compares in the common type, so max(1, ticks) doesn't trigger
+// -Wsign-compare
+template<typename T, typename U>
+inline auto max(const T& a, const U& b) -> decltype(a > b ? a : b)
+{
+	typedef decltype(a > b ? a : b) Common;
+
+	return static_cast<Common>(a) > static_cast<Common>(b) ? static_cast<Common>(a) : static_cast<Common>(b);
+}
+
+unsigned long millis();
+unsigned long micros();
+
+#define F(string_literal) (string_literal)
+
+class HostSerial
+{
+public:
+	void begin(unsigned long baud);
+
+	explicit operator bool() const
+	{
+		return true;
+	}
+
+	size_t print(const char* str);
+	size_t print(char c);
+	size_t print(long value);
+	size_t print(unsigned long value);
+	size_t print(double value);
+
+	size_t print(int value)
+	{
+		return print(static_cast<long>(value));
+	}
+
+	size_t print(unsigned int value)
+	{
+		return print(static_cast<unsigned long>(value));
+	}
+
+	size_t println();
+
+	template<typename T>
+	size_t println(const T& value)
+	{
+		return print(value) + println();
+	}
+};
+
+extern HostSerial Serial;
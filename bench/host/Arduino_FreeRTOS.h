@@ -0,0 +1,11 @@
+#pragma once
+
+// Stands in for the header of the Arduino_FreeRTOS_Library
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+// The POSIX port takes the "switch required" flag as argument, while
+// frt calls portYIELD_FROM_ISR() after evaluating that flag itself
+#undef portYIELD_FROM_ISR
+#define portYIELD_FROM_ISR() vPortYield()
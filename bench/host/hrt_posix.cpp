@@ -0,0 +1,75 @@
+#include <frt.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// frt::hrt backend for the POSIX port. A POSIX timer raises a real-time
+// signal, which the port treats just like its tick interrupt: It's
+// blocked in critical sections and only delivered to the thread of the
+// running task.
+
+namespace
+{
+
+	timer_t timer;
+
+	void handleTimerSignal(int)
+	{
+		frt::hrt::handleInterrupt();
+	}
+
+	struct TimerSetup {
+		TimerSetup()
+		{
+			struct sigaction action = {};
+			action.sa_handler = handleTimerSignal;
+			sigfillset(&action.sa_mask);
+			sigaction(SIGRTMIN, &action, nullptr);
+
+			sigevent event = {};
+			event.sigev_notify = SIGEV_SIGNAL;
+			event.sigev_signo = SIGRTMIN;
+
+			if (timer_create(CLOCK_MONOTONIC, &event, &timer)) {
+				perror("timer_create");
+				abort();
+			}
+		}
+	};
+
+	TimerSetup timer_setup;
+
+}
+
+uint32_t frt::hrt::now()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+void frt::hrt::arm(uint32_t deadline)
+{
+	int32_t remaining = deadline - now();
+
+	// A zero it_value would disarm the timer
+	if (remaining < 1) {
+		remaining = 1;
+	}
+
+	itimerspec spec = {};
+	spec.it_value.tv_sec = remaining / 1000000;
+	spec.it_value.tv_nsec = remaining % 1000000 * 1000;
+
+	timer_settime(timer, 0, &spec, nullptr);
+}
+
+void frt::hrt::disarm()
+{
+	const itimerspec spec = {};
+
+	timer_settime(timer, 0, &spec, nullptr);
+}
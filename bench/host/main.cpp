@@ -0,0 +1,62 @@
+#include <Arduino_FreeRTOS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Mimics the Arduino_FreeRTOS_Library: setup() runs before the
+// scheduler is started and loop() is called from the idle task.
+
+void setup();
+void loop();
+
+int main()
+{
+	setup();
+
+	vTaskStartScheduler();
+
+	return EXIT_FAILURE;
+}
+
+extern "C" {
+
+	void vApplicationIdleHook()
+	{
+		loop();
+	}
+
+	void vApplicationGetIdleTaskMemory(
+		StaticTask_t** task_buffer,
+		StackType_t** stack_buffer,
+		uint32_t* stack_size
+	)
+	{
+		static StaticTask_t task;
+		static StackType_t stack[configMINIMAL_STACK_SIZE];
+
+		*task_buffer = &task;
+		*stack_buffer = stack;
+		*stack_size = configMINIMAL_STACK_SIZE;
+	}
+
+	void vApplicationGetTimerTaskMemory(
+		StaticTask_t** task_buffer,
+		StackType_t** stack_buffer,
+		uint32_t* stack_size
+	)
+	{
+		static StaticTask_t task;
+		static StackType_t stack[configTIMER_TASK_STACK_DEPTH];
+
+		*task_buffer = &task;
+		*stack_buffer = stack;
+		*stack_size = configTIMER_TASK_STACK_DEPTH;
+	}
+
+	void vAssertCalled(const char* file, unsigned long line)
+	{
+		fprintf(stderr, "FreeRTOS assertion failed at %s:%lu\n", file, line);
+		abort();
+	}
+
+}
@@ -26,19 +26,21 @@ namespace
 			// This task could be stopped, as we wait with timeout here
 			if (wait(15)) {
 				// conversion_count is concurrently accessed
-				mutex.lock();
-				++conversion_count;
-				mutex.unlock();
+				{
+					frt::LockGuard<> lock(mutex);
+					++conversion_count;
+				}
 
 				// Protect adc_value from being written while we read
-				beginCriticalSection();
-				const uint16_t adc_value_copy = adc_value;
-				endCriticalSection();
+				uint16_t adc_value_copy;
+				{
+					frt::CriticalSection critical_section;
+					adc_value_copy = adc_value;
+				}
 
 				// Serial needs to be locked against MonitoringTask
-				serial_mutex.lock();
+				frt::LockGuard<> serial_lock(serial_mutex);
 				Serial.println(adc_value_copy);
-				serial_mutex.unlock();
 
 				// If you comment out the Serial.println() above
 				// you get way more conversions per second.
@@ -50,10 +52,9 @@ namespace
 		uint32_t getAndResetConversionCount()
 		{
 			// Called from MonitoringTask, thus the mutex
-			mutex.lock();
+			frt::LockGuard<> lock(mutex);
 			const uint32_t res = conversion_count;
 			conversion_count = 0;
-			mutex.unlock();
 
 			return res;
 		}
@@ -80,12 +81,11 @@ namespace
 		{
 			msleep(1000, remainder);
 
-			serial_mutex.lock();
+			frt::LockGuard<> serial_lock(serial_mutex);
 			Serial.print(F("Print stack used: "));
 			Serial.println(print_task.getUsedStackSize());
 			Serial.print(F("Conversions per second: "));
 			Serial.println(print_task.getAndResetConversionCount());
-			serial_mutex.unlock();
 
 			return true;
 		}
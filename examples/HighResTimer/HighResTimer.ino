@@ -0,0 +1,118 @@
+// Enable Task::usleep() and Task::uwait()
+#define FRT_HIGH_RES_TIMER 1
+
+#include <frt.h>
+
+namespace
+{
+
+	// The frt::hrt backend below uses Timer1 of the ATmega328, which the
+	// Arduino core and Arduino_FreeRTOS_Library leave alone. It counts in
+	// steps of 4 microseconds (prescaler 64 at 16 MHz), the overflows
+	// extend the 16 bit counter to 32 bit.
+	volatile uint16_t timer1_overflows;
+	volatile uint32_t timer1_deadline;
+
+	// The measuring task
+	class MeasureTask final :
+		public frt::Task<MeasureTask>
+	{
+	public:
+		bool run()
+		{
+			msleep(1000, remainder);
+
+			unsigned long start = micros();
+			msleep(1);
+			const unsigned long msleep_duration = micros() - start;
+
+			start = micros();
+			usleep(1000);
+			const unsigned long usleep_duration = micros() - start;
+
+			Serial.print(F("msleep(1) took us: "));
+			Serial.println(msleep_duration);
+			Serial.print(F("usleep(1000) took us: "));
+			Serial.println(usleep_duration);
+
+			return true;
+		}
+
+	private:
+		unsigned int remainder = 0;
+	};
+
+	// The MeasureTask instance
+	MeasureTask measure_task;
+
+}
+
+uint32_t frt::hrt::now()
+{
+	const uint8_t sreg = SREG;
+	cli();
+
+	uint16_t overflows = timer1_overflows;
+	const uint16_t count = TCNT1;
+
+	// The overflow ISR might be pending while interrupts are disabled
+	if ((TIFR1 & bit(TOV1)) && count < 0x8000) {
+		++overflows;
+	}
+
+	SREG = sreg;
+
+	return (static_cast<uint32_t>(overflows) << 16 | count) * 4;
+}
+
+void frt::hrt::arm(uint32_t deadline)
+{
+	timer1_deadline = deadline;
+
+	TIFR1 = bit(OCF1A);
+	if (static_cast<int32_t>(deadline - now()) < 16) {
+		// (Almost) due, so fire right away
+		OCR1A = TCNT1 + 2;
+	} else {
+		// Round up, so now() has reached the deadline on the match
+		OCR1A = (deadline + 3) / 4;
+	}
+	TIMSK1 |= bit(OCIE1A);
+}
+
+void frt::hrt::disarm()
+{
+	TIMSK1 &= ~bit(OCIE1A);
+}
+
+void setup()
+{
+	Serial.begin(9600);
+
+	while (!Serial);
+
+	// Timer1 in normal mode, prescaler 64
+	TCCR1A = 0;
+	TCCR1B = bit(CS11) | bit(CS10);
+	TIMSK1 = bit(TOIE1);
+
+	measure_task.start(1);
+}
+
+void loop()
+{
+	// Nothing to do here
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	++timer1_overflows;
+}
+
+// The compare matches every 262 milliseconds, so check the whole deadline
+ISR(TIMER1_COMPA_vect)
+{
+	if (static_cast<int32_t>(frt::hrt::now() - timer1_deadline) >= 0) {
+		frt::hrt::handleInterrupt();
+	}
+}
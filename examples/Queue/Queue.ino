@@ -36,30 +36,33 @@ namespace
 
 	// The consumer task
 	class ConsumerTask final :
-		public frt::Task<ConsumerTask, 150>
+		public frt::Task<ConsumerTask, 180>
 	{
 	public:
 		bool run()
 		{
-			Data data;
+			Data data[5];
 
-			// Get the (possibly old) data from the queue
-			queue.pop(data);
+			// Get all the (possibly old) data from the queue at once,
+			// but at most five items
+			const unsigned int count = queue.popMany(data, 5);
 
-			// This variant of pop() will wait forever for data to
-			// arrive. If you ever plan to stop this task, use a
+			// This variant of popMany() will wait forever for the first
+			// item to arrive. If you ever plan to stop this task, use a
 			// variant with timeout, so run() is left once in a while.
 
 			const unsigned long now = millis();
 
 			// If you dare, try to remove the mutex and see what happens
 			serial_mutex.lock();
-			Serial.print(F("Got value "));
-			Serial.print(data.value);
-			Serial.print(F(" at "));
-			Serial.print(now);
-			Serial.print(F(" which was queued at "));
-			Serial.println(data.timestamp);
+			for (unsigned int i = 0; i < count; ++i) {
+				Serial.print(F("Got value "));
+				Serial.print(data[i].value);
+				Serial.print(F(" at "));
+				Serial.print(now);
+				Serial.print(F(" which was queued at "));
+				Serial.println(data[i].timestamp);
+			}
 			serial_mutex.unlock();
 
 			// Again, no msleep() here
@@ -113,10 +116,10 @@ void setup()
 
 	// As the consumer task is started with lower priority first, the
 	// moment the producer starts, it will fill the queue completely
-	// and stall. The consumer will wake and pop one element, then the
-	// producer will kick in again filling the queue (only one item).
-	// Only then the consumer will print out its line. It continues into
-	// run() and pops one item, and so on.
+	// and stall. The consumer will wake and pop up to five elements in
+	// one go, then the producer will kick in again filling the queue.
+	// Only then the consumer will print out its lines. It continues into
+	// run() and pops the next batch, and so on.
 	// You should play a bit with the start sequence and priorities here
 	// to get a feeling on what's going on.
 	consumer_task.start(1);
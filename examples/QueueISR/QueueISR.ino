@@ -1,3 +1,6 @@
+// Record the peak fill level and dropped samples of our queue
+#define FRT_QUEUE_STATS 1
+
 #include <frt.h>
 
 namespace
@@ -78,8 +81,15 @@ namespace
 			msleep(1000, remainder);
 
 			serial_mutex.lock();
+			const frt::QueueStats queue_stats = queue.getStats();
+			queue.resetStats();
+
 			Serial.print(F("Queue fill level: "));
 			Serial.println(queue.getFillLevel());
+			Serial.print(F("Queue peak fill level: "));
+			Serial.println(queue_stats.max_fill_level);
+			Serial.print(F("Samples dropped: "));
+			Serial.println(queue_stats.failed_interrupt_pushes);
 			Serial.print(F("Print stack used: "));
 			Serial.println(print_task.getUsedStackSize());
 			Serial.print(F("Conversions per second: "));
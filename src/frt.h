@@ -25,8 +25,31 @@
 
 #include <Arduino.h>
 #include <Arduino_FreeRTOS.h>
+#include <event_groups.h>
+#include <message_buffer.h>
 #include <queue.h>
 #include <semphr.h>
+#include <stream_buffer.h>
+#include <timers.h>
+
+// Define to 1 before including frt.h (in every translation unit) to
+// record lock statistics in frt::Mutex
+#ifndef FRT_MUTEX_STATS
+#define FRT_MUTEX_STATS 0
+#endif
+
+// Define to 1 before including frt.h (in every translation unit) to
+// record fill level and overrun statistics in frt::Queue
+#ifndef FRT_QUEUE_STATS
+#define FRT_QUEUE_STATS 0
+#endif
+
+// Define to 1 before including frt.h (in every translation unit) to
+// enable Task::usleep() and Task::uwait(). The functions in frt::hrt
+// must then be implemented by a timer backend.
+#ifndef FRT_HIGH_RES_TIMER
+#define FRT_HIGH_RES_TIMER 0
+#endif
 
 namespace frt
 {
@@ -48,7 +71,263 @@ namespace frt
 			#endif
 		}
 
+		// frt wakes its internal waits with eNoAction, which leaves the
+		// notification value alone and only marks the task as notified.
+		// If such a wait consumed a mark that came from someone else,
+		// set it again, so a later waitBits() doesn't miss it.
+		inline void restoreNotificationState(bool woken_by_other)
+		{
+			if (woken_by_other) {
+				xTaskNotify(xTaskGetCurrentTaskHandle(), 0, eNoAction);
+			}
+		}
+
+		// Without static allocation the kernel takes these bytes from
+		// the heap on creation
+		constexpr size_t getHeapFootprint(size_t bytes)
+		{
+			return configSUPPORT_STATIC_ALLOCATION > 0 ? 0 : bytes;
+		}
+
+	}
+
+	class IsrScope final
+	{
+	public:
+		IsrScope() __attribute__((always_inline)) :
+			higher_priority_task_woken(pdFALSE)
+		{
+		}
+
+		~IsrScope() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+
+		explicit IsrScope(const IsrScope& other) = delete;
+		IsrScope& operator =(const IsrScope& other) = delete;
+
+		// For calling FreeRTOS *FromISR() functions directly
+		BaseType_t* getHigherPriorityTaskWoken() __attribute__((always_inline))
+		{
+			return &higher_priority_task_woken;
+		}
+
+	private:
+		BaseType_t higher_priority_task_woken;
+	};
+
+	enum class NotifyAction {
+		SET_BITS = eSetBits,
+		INCREMENT = eIncrement,
+		OVERWRITE = eSetValueWithOverwrite,
+		NO_OVERWRITE = eSetValueWithoutOverwrite
+	};
+
+#if configUSE_TRACE_FACILITY > 0 && configGENERATE_RUN_TIME_STATS > 0
+	enum class TaskState {
+		RUNNING = eRunning,
+		READY = eReady,
+		BLOCKED = eBlocked,
+		SUSPENDED = eSuspended,
+		DELETED = eDeleted
+	};
+
+	struct TaskStats {
+		const char* name;
+		TaskState state;
+		unsigned char priority;
+		unsigned int free_stack_size;
+		uint32_t run_time;
+		unsigned char cpu_percent;
+	};
+
+	namespace detail {
+
+		inline uint32_t getRunTimeCounter()
+		{
+#ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+			uint32_t value;
+			portALT_GET_RUN_TIME_COUNTER_VALUE(value);
+			return value;
+#else
+			return portGET_RUN_TIME_COUNTER_VALUE();
+#endif
+		}
+
+		inline TaskStats makeTaskStats(const TaskStatus_t& status, uint32_t run_time, uint32_t total_run_time)
+		{
+			// Divide the total first, so that nothing can overflow
+			total_run_time /= 100;
+			const uint32_t percent =
+				total_run_time
+					? run_time / total_run_time
+					: 0;
+
+			TaskStats stats;
+			stats.name = status.pcTaskName;
+			stats.state = static_cast<TaskState>(status.eCurrentState);
+			stats.priority = status.uxCurrentPriority;
+			stats.free_stack_size = status.usStackHighWaterMark * sizeof(StackType_t);
+			stats.run_time = status.ulRunTimeCounter;
+			stats.cpu_percent =
+				percent > 100
+					? 100
+					: percent;
+
+			return stats;
+		}
+
+	}
+
+	template<unsigned int MAX_TASKS, typename F>
+	unsigned int forEachTask(F f)
+	{
+		TaskStatus_t statuses[MAX_TASKS];
+		uint32_t total_run_time;
+
+		// Returns 0 if there are more than MAX_TASKS tasks
+		const UBaseType_t count = uxTaskGetSystemState(statuses, MAX_TASKS, &total_run_time);
+
+		for (UBaseType_t i = 0; i < count; ++i) {
+			f(detail::makeTaskStats(statuses[i], statuses[i].ulRunTimeCounter, total_run_time));
+		}
+
+		return count;
+	}
+#endif
+
+#if FRT_HIGH_RES_TIMER > 0
+	namespace hrt {
+
+		// Implemented by the backend. now() is a free running microsecond
+		// clock wrapping at 2^32. arm() and disarm() are called with
+		// interrupts disabled: arm() must make the backend call
+		// handleInterrupt() from its ISR once now() reached the deadline,
+		// or as soon as possible if it already has.
+		uint32_t now();
+		void arm(uint32_t deadline);
+		void disarm();
+
+	}
+
+	namespace detail {
+
+		class HrtWaiter final
+		{
+		public:
+			explicit HrtWaiter(uint32_t usecs) :
+				deadline(hrt::now() + usecs),
+				task(xTaskGetCurrentTaskHandle()),
+				next(nullptr),
+				fired(false)
+			{
+				taskENTER_CRITICAL();
+				HrtWaiter** link = &head();
+				while (*link && static_cast<int32_t>((*link)->deadline - deadline) <= 0) {
+					link = &(*link)->next;
+				}
+				next = *link;
+				*link = this;
+				if (head() == this) {
+					hrt::arm(deadline);
+				}
+				taskEXIT_CRITICAL();
+			}
+
+			~HrtWaiter()
+			{
+				cancel();
+			}
+
+			explicit HrtWaiter(const HrtWaiter& other) = delete;
+			HrtWaiter& operator =(const HrtWaiter& other) = delete;
+
+			bool hasFired() const
+			{
+				return __atomic_load_n(&fired, __ATOMIC_ACQUIRE);
+			}
+
+			// Returns false if the waiter fired before it was cancelled
+			bool cancel()
+			{
+				taskENTER_CRITICAL();
+				const bool pending = !fired;
+				if (pending) {
+					HrtWaiter** link = &head();
+					while (*link != this) {
+						link = &(*link)->next;
+					}
+					*link = next;
+					if (link == &head()) {
+						rearm();
+					}
+					fired = true;
+				}
+				taskEXIT_CRITICAL();
+
+				return pending;
+			}
+
+			static void expire(BaseType_t* higher_priority_task_woken)
+			{
+				const uint32_t now = hrt::now();
+
+				while (head() && static_cast<int32_t>(now - head()->deadline) >= 0) {
+					HrtWaiter* const waiter = head();
+					const TaskHandle_t task = waiter->task;
+					head() = waiter->next;
+					__atomic_store_n(&waiter->fired, true, __ATOMIC_RELEASE);
+					xTaskNotifyFromISR(task, 0, eNoAction, higher_priority_task_woken);
+				}
+
+				rearm();
+			}
+
+		private:
+			static HrtWaiter*& head()
+			{
+				static HrtWaiter* head = nullptr;
+				return head;
+			}
+
+			static void rearm()
+			{
+				if (head()) {
+					hrt::arm(head()->deadline);
+				} else {
+					hrt::disarm();
+				}
+			}
+
+			const uint32_t deadline;
+			const TaskHandle_t task;
+			HrtWaiter* next;
+			bool fired;
+		};
+
+	}
+
+	namespace hrt {
+
+		// Call one of these from the ISR of the backend
+		inline void handleInterrupt(IsrScope& scope)
+		{
+			const UBaseType_t saved_state = taskENTER_CRITICAL_FROM_ISR();
+			detail::HrtWaiter::expire(scope.getHigherPriorityTaskWoken());
+			taskEXIT_CRITICAL_FROM_ISR(saved_state);
+		}
+
+		inline void handleInterrupt()
+		{
+			IsrScope scope;
+			handleInterrupt(scope);
+		}
+
 	}
+#endif
 
 	template<typename T, unsigned int STACK_SIZE = configMINIMAL_STACK_SIZE * sizeof(StackType_t)>
 	class Task
@@ -57,7 +336,8 @@ namespace frt
 		Task() :
 			running(false),
 			do_stop(false),
-			handle(nullptr)
+			handle(nullptr),
+			stopper(nullptr)
 		{
 		}
 
@@ -69,12 +349,23 @@ namespace frt
 		explicit Task(const Task& other) = delete;
 		Task& operator =(const Task& other) = delete;
 
+		// Includes the members of the derived class
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(T) + detail::getHeapFootprint(STACK_SIZE / sizeof(StackType_t) * sizeof(StackType_t) + sizeof(StaticTask_t));
+		}
+
 		bool start(unsigned char priority = 0, const char* name = "")
 		{
 			if (priority >= configMAX_PRIORITIES) {
 				priority = configMAX_PRIORITIES - 1;
 			}
 
+#if configUSE_TRACE_FACILITY > 0 && configGENERATE_RUN_TIME_STATS > 0
+			last_run_time = 0;
+			last_total_run_time = detail::getRunTimeCounter();
+#endif
+
 #if configSUPPORT_STATIC_ALLOCATION > 0
 			handle = xTaskCreateStatic(
 				entryPoint,
@@ -101,21 +392,40 @@ namespace frt
 
 		bool stop()
 		{
-			return stop(false);
+			return stopAndJoin(portMAX_DELAY, false);
 		}
 
-		bool stopFromIdleTask()
+		bool stop(unsigned int msecs, bool wake = false)
 		{
-			return stop(true);
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return stopAndJoin(max(1, ticks), wake);
 		}
 
-		bool isRunning() const
+		bool stopFromIdleTask(bool wake = false)
 		{
-			taskENTER_CRITICAL();
-			const bool res = running;
-			taskEXIT_CRITICAL();
+			if (!handle) {
+				return false;
+			}
 
-			return res;
+			// The idle task must never block, so poll here
+			vTaskSuspendAll();
+			do_stop = true;
+			if (wake && running) {
+				xTaskNotifyGive(handle);
+			}
+			xTaskResumeAll();
+
+			while (isRunning()) {
+				taskYIELD();
+			}
+
+			return true;
+		}
+
+		bool isRunning() const
+		{
+			return __atomic_load_n(&running, __ATOMIC_ACQUIRE);
 		}
 
 		unsigned int getUsedStackSize() const
@@ -123,6 +433,31 @@ namespace frt
 			return STACK_SIZE - uxTaskGetStackHighWaterMark(handle) * sizeof(StackType_t);
 		}
 
+#if configUSE_TRACE_FACILITY > 0 && configGENERATE_RUN_TIME_STATS > 0
+		bool getRuntimeStats(TaskStats& stats)
+		{
+			if (!handle) {
+				return false;
+			}
+
+			TaskStatus_t status;
+			vTaskGetInfo(handle, &status, pdTRUE, eInvalid);
+			const uint32_t total_run_time = detail::getRunTimeCounter();
+
+			// The CPU share is the one since the last query
+			stats = detail::makeTaskStats(
+				status,
+				status.ulRunTimeCounter - last_run_time,
+				total_run_time - last_total_run_time
+			);
+
+			last_run_time = status.ulRunTimeCounter;
+			last_total_run_time = total_run_time;
+
+			return true;
+		}
+#endif
+
 		void post()
 		{
 			xTaskNotifyGive(handle);
@@ -133,305 +468,2909 @@ namespace frt
 			higher_priority_task_woken = 0;
 		}
 
-		void postFromInterrupt()
-		{
-			vTaskNotifyGiveFromISR(handle, &higher_priority_task_woken);
-		}
+		void postFromInterrupt()
+		{
+			vTaskNotifyGiveFromISR(handle, &higher_priority_task_woken);
+		}
+
+		void postFromInterrupt(IsrScope& scope)
+		{
+			vTaskNotifyGiveFromISR(handle, scope.getHigherPriorityTaskWoken());
+		}
+
+		bool notify(uint32_t value, NotifyAction action = NotifyAction::SET_BITS)
+		{
+			return xTaskNotify(handle, value, static_cast<eNotifyAction>(action)) == pdPASS;
+		}
+
+		bool notifyFromInterrupt(uint32_t value, NotifyAction action = NotifyAction::SET_BITS)
+		{
+			return
+				xTaskNotifyFromISR(
+					handle,
+					value,
+					static_cast<eNotifyAction>(action),
+					&higher_priority_task_woken
+				) == pdPASS;
+		}
+
+		bool notifyFromInterrupt(IsrScope& scope, uint32_t value, NotifyAction action = NotifyAction::SET_BITS)
+		{
+			return
+				xTaskNotifyFromISR(
+					handle,
+					value,
+					static_cast<eNotifyAction>(action),
+					scope.getHigherPriorityTaskWoken()
+				) == pdPASS;
+		}
+
+		void finalizePostFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+
+	protected:
+		void yield()
+		{
+			taskYIELD();
+		}
+
+		void msleep(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			vTaskDelay(max(1, ticks));
+		}
+
+		void msleep(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			vTaskDelay(max(1, ticks));
+		}
+
+#if FRT_HIGH_RES_TIMER > 0
+		void usleep(uint32_t usecs)
+		{
+			const detail::HrtWaiter waiter(usecs);
+			bool woken_by_other = false;
+
+			// The waiter is marked fired before it notifies us, so only
+			// a wake-up before that came from someone else
+			xTaskNotifyWait(0, 0, nullptr, portMAX_DELAY);
+			while (!waiter.hasFired()) {
+				woken_by_other = true;
+				xTaskNotifyWait(0, 0, nullptr, portMAX_DELAY);
+			}
+
+			detail::restoreNotificationState(woken_by_other);
+		}
+
+		bool uwait(uint32_t usecs)
+		{
+			detail::HrtWaiter waiter(usecs);
+			uint32_t notifications = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			bool woken_by_other = false;
+
+			// The waiter leaves the notification value alone, so waking
+			// up with zero before it fired means someone else notified
+			// us without touching the value
+			while (!notifications && !waiter.hasFired()) {
+				woken_by_other = true;
+				notifications = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			}
+
+			if (notifications && !waiter.cancel()) {
+				// It fired after all, drop its pending notification
+				xTaskNotifyWait(0, 0, nullptr, 0);
+			}
+
+			detail::restoreNotificationState(woken_by_other);
+
+			return notifications;
+		}
+#endif
+
+		void wait()
+		{
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		}
+
+		bool wait(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return ulTaskNotifyTake(pdTRUE, max(1, ticks));
+		}
+
+		bool wait(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (ulTaskNotifyTake(pdTRUE, max(1, ticks))) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		uint32_t waitCount()
+		{
+			return ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		}
+
+		uint32_t waitCount(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return ulTaskNotifyTake(pdTRUE, max(1, ticks));
+		}
+
+		uint32_t waitCount(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const uint32_t count = ulTaskNotifyTake(pdTRUE, max(1, ticks));
+
+			if (count) {
+				remainder = 0;
+			}
+
+			return count;
+		}
+
+		uint32_t waitOne()
+		{
+			return ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+		}
+
+		uint32_t waitOne(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return ulTaskNotifyTake(pdFALSE, max(1, ticks));
+		}
+
+		uint32_t waitOne(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const uint32_t count = ulTaskNotifyTake(pdFALSE, max(1, ticks));
+
+			if (count) {
+				remainder = 0;
+			}
+
+			return count;
+		}
+
+		uint32_t waitBits(uint32_t clear_on_entry, uint32_t clear_on_exit)
+		{
+			uint32_t value;
+			xTaskNotifyWait(clear_on_entry, clear_on_exit, &value, portMAX_DELAY);
+
+			return value;
+		}
+
+		bool waitBits(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t& value, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xTaskNotifyWait(clear_on_entry, clear_on_exit, &value, max(1, ticks)) == pdTRUE;
+		}
+
+		bool waitBits(
+			uint32_t clear_on_entry,
+			uint32_t clear_on_exit,
+			uint32_t& value,
+			unsigned int msecs,
+			unsigned int& remainder
+		)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xTaskNotifyWait(clear_on_entry, clear_on_exit, &value, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		void beginCriticalSection() __attribute__((always_inline))
+		{
+			taskENTER_CRITICAL();
+		}
+
+		void endCriticalSection() __attribute__((always_inline))
+		{
+			taskEXIT_CRITICAL();
+		}
+
+	private:
+		bool stopAndJoin(TickType_t ticks, bool wake)
+		{
+			if (!handle) {
+				return false;
+			}
+
+			const TaskHandle_t current = xTaskGetCurrentTaskHandle();
+
+			// With the scheduler suspended, entryPoint() can't leave
+			// between checking running and registering as stopper
+			vTaskSuspendAll();
+			do_stop = true;
+			const bool was_running = running;
+			const bool joining = was_running && !stopper;
+			if (joining) {
+				stopper = current;
+			}
+			if (wake && was_running) {
+				xTaskNotifyGive(handle);
+			}
+			xTaskResumeAll();
+
+			if (!was_running) {
+				return true;
+			}
+
+			TimeOut_t timeout;
+			vTaskSetTimeOutState(&timeout);
+
+			bool woken_by_other = false;
+			bool woken_by_exit = false;
+
+			do {
+				if (joining) {
+					// entryPoint() clears running before it notifies us,
+					// so a wake-up while it's still set came from someone
+					// else
+					if (xTaskNotifyWait(0, 0, nullptr, ticks) == pdTRUE) {
+						if (isRunning()) {
+							woken_by_other = true;
+						} else {
+							woken_by_exit = true;
+						}
+					}
+				} else {
+					// Someone else is already joining, fall back to polling
+					vTaskDelay(1);
+				}
+			} while (isRunning() && !xTaskCheckForTimeOut(&timeout, &ticks));
+
+			if (!joining) {
+				return !isRunning();
+			}
+
+			vTaskSuspendAll();
+			const bool stopped = !running;
+			if (!stopped) {
+				stopper = nullptr;
+			}
+			xTaskResumeAll();
+
+			if (stopped && !woken_by_exit) {
+				// entryPoint() notified us, but we didn't wait for it
+				xTaskNotifyWait(0, 0, nullptr, 0);
+			}
+
+			detail::restoreNotificationState(woken_by_other);
+
+			return stopped;
+		}
+
+		static void entryPoint(void* data)
+		{
+			Task* const self = static_cast<Task*>(data);
+
+			__atomic_store_n(&self->running, true, __ATOMIC_SEQ_CST);
+
+			// Flags are single bytes, which every port reads atomically,
+			// so there's no need to mask interrupts around each run()
+			while (
+				!__atomic_load_n(&self->do_stop, __ATOMIC_ACQUIRE)
+				&& static_cast<T*>(self)->run()
+			) {
+			}
+
+			vTaskSuspendAll();
+			self->do_stop = false;
+			self->running = false;
+			const TaskHandle_t handle_copy = self->handle;
+			self->handle = nullptr;
+			if (self->stopper) {
+				xTaskNotify(self->stopper, 0, eNoAction);
+				self->stopper = nullptr;
+			}
+			xTaskResumeAll();
+
+			vTaskDelete(handle_copy);
+		}
+
+		volatile bool running;
+		volatile bool do_stop;
+		TaskHandle_t handle;
+		TaskHandle_t stopper;
+		BaseType_t higher_priority_task_woken;
+#if configUSE_TRACE_FACILITY > 0 && configGENERATE_RUN_TIME_STATS > 0
+		// Set by start(), only read with a valid handle
+		uint32_t last_run_time;
+		uint32_t last_total_run_time;
+#endif
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		StackType_t stack[STACK_SIZE / sizeof(StackType_t)];
+		StaticTask_t state;
+#endif
+	};
+
+	template<typename T, unsigned int PERIOD_MS, unsigned int STACK_SIZE = configMINIMAL_STACK_SIZE * sizeof(StackType_t)>
+	class PeriodicTask :
+		public Task<PeriodicTask<T, PERIOD_MS, STACK_SIZE>, STACK_SIZE>
+	{
+		static_assert(PERIOD_MS >= portTICK_PERIOD_MS, "PERIOD_MS must be at least one tick");
+
+	public:
+		PeriodicTask() :
+			last_wake(0),
+			period_remainder(0),
+			overrun_count(0),
+			max_lateness(0)
+		{
+		}
+
+		bool start(unsigned char priority = 0, const char* name = "")
+		{
+			last_wake = xTaskGetTickCount();
+			period_remainder = 0;
+
+			return Task<PeriodicTask, STACK_SIZE>::start(priority, name);
+		}
+
+		// Includes the members of the derived class
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(T) + Task<PeriodicTask, STACK_SIZE>::getFootprint() - sizeof(PeriodicTask);
+		}
+
+		unsigned int getOverrunCount() const
+		{
+			taskENTER_CRITICAL();
+			const unsigned int res = overrun_count;
+			taskEXIT_CRITICAL();
+
+			return res;
+		}
+
+		unsigned int getMaxLateness() const
+		{
+			taskENTER_CRITICAL();
+			const TickType_t res = max_lateness;
+			taskEXIT_CRITICAL();
+
+			return res * portTICK_PERIOD_MS;
+		}
+
+		void resetOverrunStatistics()
+		{
+			taskENTER_CRITICAL();
+			overrun_count = 0;
+			max_lateness = 0;
+			taskEXIT_CRITICAL();
+		}
+
+	private:
+		friend class Task<PeriodicTask, STACK_SIZE>;
+
+		bool run()
+		{
+			if (!static_cast<T*>(this)->run()) {
+				return false;
+			}
+
+			TickType_t ticks = nextPeriodTicks();
+			TickType_t elapsed = xTaskGetTickCount() - last_wake;
+
+			if (elapsed > ticks) {
+				const TickType_t lateness = elapsed - ticks;
+
+				taskENTER_CRITICAL();
+				++overrun_count;
+				if (lateness > max_lateness) {
+					max_lateness = lateness;
+				}
+				taskEXIT_CRITICAL();
+
+				// Skip the periods we missed, but stay in phase
+				do {
+					last_wake += ticks;
+					elapsed -= ticks;
+					ticks = nextPeriodTicks();
+				} while (elapsed > ticks);
+			}
+
+			vTaskDelayUntil(&last_wake, ticks);
+
+			return true;
+		}
+
+		TickType_t nextPeriodTicks()
+		{
+			// Carry the fraction of a tick over to the next period, so
+			// periods that aren't a multiple of the tick don't drift
+			period_remainder += PERIOD_MS;
+			const TickType_t ticks = period_remainder / portTICK_PERIOD_MS;
+			period_remainder %= portTICK_PERIOD_MS;
+
+			return ticks;
+		}
+
+		TickType_t last_wake;
+		unsigned int period_remainder;
+		unsigned int overrun_count;
+		TickType_t max_lateness;
+	};
+
+#if configUSE_TIMERS > 0
+	template<typename T, bool AUTO_RELOAD = true>
+	class Timer
+	{
+	public:
+		Timer(const char* name = "") :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xTimerCreateStatic(name, 1, AUTO_RELOAD, this, callback, &buffer)
+#else
+				xTimerCreate(name, 1, AUTO_RELOAD, this, callback)
+#endif
+			)
+		{
+		}
+
+		~Timer()
+		{
+			xTimerDelete(handle, portMAX_DELAY);
+
+#if INCLUDE_xTimerPendFunctionCall > 0
+			// The delete is only queued. The timer service task handles
+			// its commands in order, so once it ran deleted(), it's done
+			// with our buffer and we can go.
+			if (
+				xTaskGetSchedulerState() == taskSCHEDULER_RUNNING
+				&& xTaskGetCurrentTaskHandle() != xTimerGetTimerDaemonTaskHandle()
+			) {
+				Deletion deletion = {xTaskGetCurrentTaskHandle(), false};
+
+				bool woken_by_other = false;
+
+				// deleted() notifies us exactly once, after setting done
+				xTimerPendFunctionCall(deleted, &deletion, 0, portMAX_DELAY);
+				xTaskNotifyWait(0, 0, nullptr, portMAX_DELAY);
+				while (!__atomic_load_n(&deletion.done, __ATOMIC_ACQUIRE)) {
+					woken_by_other = true;
+					xTaskNotifyWait(0, 0, nullptr, portMAX_DELAY);
+				}
+
+				detail::restoreNotificationState(woken_by_other);
+			}
+#endif
+		}
+
+		explicit Timer(const Timer& other) = delete;
+		Timer& operator =(const Timer& other) = delete;
+
+		// Includes the members of the derived class
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(T) + detail::getHeapFootprint(sizeof(StaticTimer_t));
+		}
+
+		// Commands are queued to the timer service task without
+		// blocking, as run() itself is executed by that task
+		bool start(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xTimerChangePeriod(handle, max(1, ticks), 0) == pdPASS;
+		}
+
+		bool stop()
+		{
+			return xTimerStop(handle, 0) == pdPASS;
+		}
+
+		bool reset()
+		{
+			return xTimerReset(handle, 0) == pdPASS;
+		}
+
+		bool isRunning() const
+		{
+			return xTimerIsTimerActive(handle) != pdFALSE;
+		}
+
+		void prepareFromInterrupt()
+		{
+			higher_priority_task_woken = 0;
+		}
+
+		bool startFromInterrupt(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xTimerChangePeriodFromISR(handle, max(1, ticks), &higher_priority_task_woken) == pdPASS;
+		}
+
+		bool stopFromInterrupt()
+		{
+			return xTimerStopFromISR(handle, &higher_priority_task_woken) == pdPASS;
+		}
+
+		bool resetFromInterrupt()
+		{
+			return xTimerResetFromISR(handle, &higher_priority_task_woken) == pdPASS;
+		}
+
+		bool startFromInterrupt(IsrScope& scope, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xTimerChangePeriodFromISR(handle, max(1, ticks), scope.getHigherPriorityTaskWoken()) == pdPASS;
+		}
+
+		bool stopFromInterrupt(IsrScope& scope)
+		{
+			return xTimerStopFromISR(handle, scope.getHigherPriorityTaskWoken()) == pdPASS;
+		}
+
+		bool resetFromInterrupt(IsrScope& scope)
+		{
+			return xTimerResetFromISR(handle, scope.getHigherPriorityTaskWoken()) == pdPASS;
+		}
+
+		void finalizeFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+
+	private:
+		static void callback(TimerHandle_t timer)
+		{
+			Timer* const self = static_cast<Timer*>(pvTimerGetTimerID(timer));
+
+			if (!static_cast<T*>(self)->run() && AUTO_RELOAD) {
+				xTimerStop(timer, 0);
+			}
+		}
+
+#if INCLUDE_xTimerPendFunctionCall > 0
+		struct Deletion {
+			TaskHandle_t task;
+			bool done;
+		};
+
+		static void deleted(void* data, uint32_t)
+		{
+			Deletion* const deletion = static_cast<Deletion*>(data);
+
+			// The destructor must not return in between, as deletion
+			// lives on its stack
+			taskENTER_CRITICAL();
+			__atomic_store_n(&deletion->done, true, __ATOMIC_RELEASE);
+			xTaskNotify(deletion->task, 0, eNoAction);
+			taskEXIT_CRITICAL();
+		}
+#endif
+
+		TimerHandle_t handle;
+		BaseType_t higher_priority_task_woken;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		StaticTimer_t buffer;
+#endif
+	};
+#endif
+
+#if FRT_MUTEX_STATS > 0
+	struct MutexStats {
+		unsigned long lock_count;
+		unsigned long contended_count;
+		unsigned long max_wait_us;
+		unsigned long max_hold_us;
+	};
+
+	namespace detail {
+
+		class MutexStatsRecorder final
+		{
+		public:
+			MutexStatsRecorder() :
+				stats(),
+				lock_time(0)
+			{
+			}
+
+			bool take(SemaphoreHandle_t handle, TickType_t ticks)
+			{
+				bool contended = false;
+				unsigned long wait = 0;
+
+				// Only a failed first attempt costs a second kernel call
+				if (xSemaphoreTake(handle, 0) != pdTRUE) {
+					if (!ticks) {
+						return false;
+					}
+
+					const unsigned long wait_start = micros();
+					if (xSemaphoreTake(handle, ticks) != pdTRUE) {
+						return false;
+					}
+
+					contended = true;
+					wait = micros() - wait_start;
+				}
+
+				const unsigned long now = micros();
+
+				taskENTER_CRITICAL();
+				++stats.lock_count;
+				if (contended) {
+					++stats.contended_count;
+					if (wait > stats.max_wait_us) {
+						stats.max_wait_us = wait;
+					}
+				}
+				lock_time = now;
+				taskEXIT_CRITICAL();
+
+				return true;
+			}
+
+			void release()
+			{
+				const unsigned long now = micros();
+
+				taskENTER_CRITICAL();
+				const unsigned long hold = now - lock_time;
+				if (hold > stats.max_hold_us) {
+					stats.max_hold_us = hold;
+				}
+				taskEXIT_CRITICAL();
+			}
+
+			MutexStats get() const
+			{
+				taskENTER_CRITICAL();
+				const MutexStats res = stats;
+				taskEXIT_CRITICAL();
+
+				return res;
+			}
+
+			void reset()
+			{
+				taskENTER_CRITICAL();
+				stats = MutexStats();
+				taskEXIT_CRITICAL();
+			}
+
+		private:
+			MutexStats stats;
+			unsigned long lock_time;
+		};
+
+	}
+#endif
+
+	class Mutex final
+	{
+	public:
+		Mutex() :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xSemaphoreCreateMutexStatic(&buffer)
+#else
+				xSemaphoreCreateMutex()
+#endif
+			)
+		{
+		}
+
+		~Mutex()
+		{
+			vSemaphoreDelete(handle);
+		}
+
+		explicit Mutex(const Mutex& other) = delete;
+		Mutex& operator =(const Mutex& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(Mutex) + detail::getHeapFootprint(sizeof(StaticSemaphore_t));
+		}
+
+		void lock()
+		{
+			take(portMAX_DELAY);
+		}
+
+		bool tryLock()
+		{
+			return take(0);
+		}
+
+		bool lock(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return take(max(1, ticks));
+		}
+
+		bool lock(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (take(max(1, ticks))) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		void unlock()
+		{
+#if FRT_MUTEX_STATS > 0
+			stats.release();
+#endif
+			xSemaphoreGive(handle);
+		}
+
+#if INCLUDE_xSemaphoreGetMutexHolder > 0
+		// Both are only a snapshot, the holder may change right after
+		bool isLocked() const
+		{
+			return xSemaphoreGetMutexHolder(handle);
+		}
+
+		const char* getHolderName() const
+		{
+			const TaskHandle_t holder = xSemaphoreGetMutexHolder(handle);
+
+			return
+				holder
+					? pcTaskGetName(holder)
+					: nullptr;
+		}
+#endif
+
+#if FRT_MUTEX_STATS > 0
+		MutexStats getStats() const
+		{
+			return stats.get();
+		}
+
+		void resetStats()
+		{
+			stats.reset();
+		}
+#endif
+
+	private:
+		bool take(TickType_t ticks)
+		{
+#if FRT_MUTEX_STATS > 0
+			return stats.take(handle, ticks);
+#else
+			return xSemaphoreTake(handle, ticks) == pdTRUE;
+#endif
+		}
+
+		SemaphoreHandle_t handle;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		StaticSemaphore_t buffer;
+#endif
+#if FRT_MUTEX_STATS > 0
+		detail::MutexStatsRecorder stats;
+#endif
+	};
+
+#if configUSE_RECURSIVE_MUTEXES > 0
+	class RecursiveMutex final
+	{
+	public:
+		RecursiveMutex() :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xSemaphoreCreateRecursiveMutexStatic(&buffer)
+#else
+				xSemaphoreCreateRecursiveMutex()
+#endif
+			)
+		{
+		}
+
+		~RecursiveMutex()
+		{
+			vSemaphoreDelete(handle);
+		}
+
+		explicit RecursiveMutex(const RecursiveMutex& other) = delete;
+		RecursiveMutex& operator =(const RecursiveMutex& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(RecursiveMutex) + detail::getHeapFootprint(sizeof(StaticSemaphore_t));
+		}
+
+		void lock()
+		{
+			xSemaphoreTakeRecursive(handle, portMAX_DELAY);
+		}
+
+		bool tryLock()
+		{
+			return xSemaphoreTakeRecursive(handle, 0) == pdTRUE;
+		}
+
+		bool lock(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xSemaphoreTakeRecursive(handle, max(1, ticks)) == pdTRUE;
+		}
+
+		bool lock(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xSemaphoreTakeRecursive(handle, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		void unlock()
+		{
+			xSemaphoreGiveRecursive(handle);
+		}
+
+#if INCLUDE_xSemaphoreGetMutexHolder > 0
+		// Both are only a snapshot, the holder may change right after
+		bool isLocked() const
+		{
+			return xSemaphoreGetMutexHolder(handle);
+		}
+
+		const char* getHolderName() const
+		{
+			const TaskHandle_t holder = xSemaphoreGetMutexHolder(handle);
+
+			return
+				holder
+					? pcTaskGetName(holder)
+					: nullptr;
+		}
+#endif
+
+	private:
+		SemaphoreHandle_t handle;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		StaticSemaphore_t buffer;
+#endif
+	};
+#endif
+
+	template<typename M = Mutex>
+	class LockGuard final
+	{
+	public:
+		explicit LockGuard(M& _mutex) __attribute__((always_inline)) :
+			mutex(_mutex)
+		{
+			mutex.lock();
+		}
+
+		~LockGuard() __attribute__((always_inline))
+		{
+			mutex.unlock();
+		}
+
+		explicit LockGuard(const LockGuard& other) = delete;
+		LockGuard& operator =(const LockGuard& other) = delete;
+
+	private:
+		M& mutex;
+	};
+
+	struct DeferLock {
+	};
+
+	constexpr DeferLock defer_lock = {};
+
+	template<typename M = Mutex>
+	class UniqueLock final
+	{
+	public:
+		explicit UniqueLock(M& _mutex) __attribute__((always_inline)) :
+			mutex(_mutex),
+			owns(true)
+		{
+			mutex.lock();
+		}
+
+		UniqueLock(M& _mutex, DeferLock) __attribute__((always_inline)) :
+			mutex(_mutex),
+			owns(false)
+		{
+		}
+
+		~UniqueLock() __attribute__((always_inline))
+		{
+			if (owns) {
+				mutex.unlock();
+			}
+		}
+
+		explicit UniqueLock(const UniqueLock& other) = delete;
+		UniqueLock& operator =(const UniqueLock& other) = delete;
+
+		void lock() __attribute__((always_inline))
+		{
+			mutex.lock();
+			owns = true;
+		}
+
+		bool tryLock() __attribute__((always_inline))
+		{
+			owns = mutex.tryLock();
+			return owns;
+		}
+
+		bool lock(unsigned int msecs) __attribute__((always_inline))
+		{
+			owns = mutex.lock(msecs);
+			return owns;
+		}
+
+		bool lock(unsigned int msecs, unsigned int& remainder) __attribute__((always_inline))
+		{
+			owns = mutex.lock(msecs, remainder);
+			return owns;
+		}
+
+		void unlock() __attribute__((always_inline))
+		{
+			mutex.unlock();
+			owns = false;
+		}
+
+		bool ownsLock() const
+		{
+			return owns;
+		}
+
+	private:
+		M& mutex;
+		bool owns;
+	};
+
+	class CriticalSection final
+	{
+	public:
+		CriticalSection() __attribute__((always_inline))
+		{
+			taskENTER_CRITICAL();
+		}
+
+		~CriticalSection() __attribute__((always_inline))
+		{
+			taskEXIT_CRITICAL();
+		}
+
+		explicit CriticalSection(const CriticalSection& other) = delete;
+		CriticalSection& operator =(const CriticalSection& other) = delete;
+	};
+
+	class InterruptCriticalSection final
+	{
+	public:
+		InterruptCriticalSection() __attribute__((always_inline)) :
+			saved_state(taskENTER_CRITICAL_FROM_ISR())
+		{
+		}
+
+		~InterruptCriticalSection() __attribute__((always_inline))
+		{
+			taskEXIT_CRITICAL_FROM_ISR(saved_state);
+		}
+
+		explicit InterruptCriticalSection(const InterruptCriticalSection& other) = delete;
+		InterruptCriticalSection& operator =(const InterruptCriticalSection& other) = delete;
+
+	private:
+		const UBaseType_t saved_state;
+	};
+
+	class Semaphore final
+	{
+	public:
+		Semaphore(bool counting = false) :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				counting
+					? xSemaphoreCreateCountingStatic(static_cast<UBaseType_t>(-1), 0, &buffer)
+					: xSemaphoreCreateBinaryStatic(&buffer)
+#else
+				counting
+					? xSemaphoreCreateCounting(static_cast<UBaseType_t>(-1), 0)
+					: xSemaphoreCreateBinary()
+#endif
+			)
+		{
+		}
+
+		~Semaphore()
+		{
+			vSemaphoreDelete(handle);
+		}
+
+		explicit Semaphore(const Semaphore& other) = delete;
+		Semaphore& operator =(const Semaphore& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(Semaphore) + detail::getHeapFootprint(sizeof(StaticSemaphore_t));
+		}
+
+		void wait()
+		{
+			xSemaphoreTake(handle, portMAX_DELAY);
+		}
+
+		bool wait(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xSemaphoreTake(handle, max(1, ticks)) == pdTRUE;
+		}
+
+		bool wait(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xSemaphoreTake(handle, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		void post()
+		{
+			xSemaphoreGive(handle);
+		}
+
+		void preparePostFromInterrupt()
+		{
+			higher_priority_task_woken = 0;
+		}
+
+		void postFromInterrupt()
+		{
+			xSemaphoreGiveFromISR(handle, &higher_priority_task_woken);
+		}
+
+		void postFromInterrupt(IsrScope& scope)
+		{
+			xSemaphoreGiveFromISR(handle, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizePostFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+
+	private:
+		template<unsigned int EVENTS>
+		friend class QueueSet;
+
+		template<typename U, unsigned int LANE_ITEMS, unsigned int LEVELS>
+		friend class PriorityQueue;
+
+		SemaphoreHandle_t handle;
+		BaseType_t higher_priority_task_woken;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		StaticSemaphore_t buffer;
+#endif
+	};
+
+	class EventGroup final
+	{
+	public:
+		EventGroup() :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xEventGroupCreateStatic(&buffer)
+#else
+				xEventGroupCreate()
+#endif
+			)
+		{
+		}
+
+		~EventGroup()
+		{
+			vEventGroupDelete(handle);
+		}
+
+		explicit EventGroup(const EventGroup& other) = delete;
+		EventGroup& operator =(const EventGroup& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(EventGroup) + detail::getHeapFootprint(sizeof(StaticEventGroup_t));
+		}
+
+		EventBits_t getBits() const
+		{
+			return xEventGroupGetBits(handle);
+		}
+
+		void set(EventBits_t bits)
+		{
+			xEventGroupSetBits(handle, bits);
+		}
+
+		void clear(EventBits_t bits)
+		{
+			xEventGroupClearBits(handle, bits);
+		}
+
+		EventBits_t waitAny(EventBits_t bits)
+		{
+			return xEventGroupWaitBits(handle, bits, pdFALSE, pdFALSE, portMAX_DELAY);
+		}
+
+		EventBits_t waitAny(EventBits_t bits, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xEventGroupWaitBits(handle, bits, pdFALSE, pdFALSE, max(1, ticks));
+		}
+
+		EventBits_t waitAny(EventBits_t bits, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const EventBits_t res = xEventGroupWaitBits(handle, bits, pdFALSE, pdFALSE, max(1, ticks));
+
+			if (res & bits) {
+				remainder = 0;
+			}
+
+			return res;
+		}
+
+		EventBits_t waitAll(EventBits_t bits)
+		{
+			return xEventGroupWaitBits(handle, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+		}
+
+		EventBits_t waitAll(EventBits_t bits, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xEventGroupWaitBits(handle, bits, pdFALSE, pdTRUE, max(1, ticks));
+		}
+
+		EventBits_t waitAll(EventBits_t bits, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const EventBits_t res = xEventGroupWaitBits(handle, bits, pdFALSE, pdTRUE, max(1, ticks));
+
+			if ((res & bits) == bits) {
+				remainder = 0;
+			}
+
+			return res;
+		}
+
+#if configUSE_TIMERS > 0 && INCLUDE_xTimerPendFunctionCall > 0
+		void prepareSetFromInterrupt()
+		{
+			higher_priority_task_woken = 0;
+		}
+
+		bool setFromInterrupt(EventBits_t bits)
+		{
+			return xEventGroupSetBitsFromISR(handle, bits, &higher_priority_task_woken) == pdPASS;
+		}
+
+		bool setFromInterrupt(IsrScope& scope, EventBits_t bits)
+		{
+			return xEventGroupSetBitsFromISR(handle, bits, scope.getHigherPriorityTaskWoken()) == pdPASS;
+		}
+
+		void finalizeSetFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+#endif
+
+	private:
+		EventGroupHandle_t handle;
+		BaseType_t higher_priority_task_woken;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		StaticEventGroup_t buffer;
+#endif
+	};
+
+#if FRT_QUEUE_STATS > 0
+	struct QueueStats {
+		unsigned int max_fill_level;
+		unsigned long failed_interrupt_pushes;
+		unsigned long push_timeouts;
+		unsigned long pop_timeouts;
+	};
+
+	namespace detail {
+
+		class QueueStatsRecorder final
+		{
+		public:
+			QueueStatsRecorder() :
+				stats()
+			{
+			}
+
+			void pushed(unsigned int fill_level)
+			{
+				taskENTER_CRITICAL();
+				if (fill_level > stats.max_fill_level) {
+					stats.max_fill_level = fill_level;
+				}
+				taskEXIT_CRITICAL();
+			}
+
+			void pushedFromInterrupt(unsigned int fill_level)
+			{
+				const UBaseType_t saved_state = taskENTER_CRITICAL_FROM_ISR();
+				if (fill_level > stats.max_fill_level) {
+					stats.max_fill_level = fill_level;
+				}
+				taskEXIT_CRITICAL_FROM_ISR(saved_state);
+			}
+
+			void interruptPushesFailed(unsigned int count)
+			{
+				const UBaseType_t saved_state = taskENTER_CRITICAL_FROM_ISR();
+				stats.failed_interrupt_pushes += count;
+				taskEXIT_CRITICAL_FROM_ISR(saved_state);
+			}
+
+			void pushTimedOut()
+			{
+				taskENTER_CRITICAL();
+				++stats.push_timeouts;
+				taskEXIT_CRITICAL();
+			}
+
+			void popTimedOut()
+			{
+				taskENTER_CRITICAL();
+				++stats.pop_timeouts;
+				taskEXIT_CRITICAL();
+			}
+
+			QueueStats get() const
+			{
+				taskENTER_CRITICAL();
+				const QueueStats res = stats;
+				taskEXIT_CRITICAL();
+
+				return res;
+			}
+
+			void reset()
+			{
+				taskENTER_CRITICAL();
+				stats = QueueStats();
+				taskEXIT_CRITICAL();
+			}
+
+		private:
+			QueueStats stats;
+		};
+
+	}
+#endif
+
+	template<typename T, unsigned int ITEMS>
+	class Queue final
+	{
+	public:
+		Queue() :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xQueueCreateStatic(ITEMS, sizeof(T), buffer, &state)
+#else
+				xQueueCreate(ITEMS, sizeof(T))
+#endif
+			)
+		{
+		}
+
+		~Queue()
+		{
+			vQueueDelete(handle);
+		}
+
+		explicit Queue(const Queue& other) = delete;
+		Queue& operator =(const Queue& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(Queue) + detail::getHeapFootprint(ITEMS * sizeof(T) + sizeof(StaticQueue_t));
+		}
+
+		unsigned int getFillLevel() const
+		{
+			return ITEMS - uxQueueSpacesAvailable(handle);
+		}
+
+		void push(const T& item)
+		{
+			xQueueSend(handle, &item, portMAX_DELAY);
+			recordPushed();
+		}
+
+		bool push(const T& item, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			if (xQueueSend(handle, &item, max(1, ticks)) == pdTRUE) {
+				recordPushed();
+				return true;
+			}
+
+			recordPushTimeout();
+			return false;
+		}
+
+		bool push(const T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xQueueSend(handle, &item, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				recordPushed();
+				return true;
+			}
+
+			recordPushTimeout();
+			return false;
+		}
+
+		void pushFront(const T& item)
+		{
+			xQueueSendToFront(handle, &item, portMAX_DELAY);
+			recordPushed();
+		}
+
+		bool pushFront(const T& item, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			if (xQueueSendToFront(handle, &item, max(1, ticks)) == pdTRUE) {
+				recordPushed();
+				return true;
+			}
+
+			recordPushTimeout();
+			return false;
+		}
+
+		bool pushFront(const T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xQueueSendToFront(handle, &item, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				recordPushed();
+				return true;
+			}
+
+			recordPushTimeout();
+			return false;
+		}
+
+		unsigned int pushMany(const T* items, unsigned int count)
+		{
+			return pushManyBlocking(items, count, portMAX_DELAY);
+		}
+
+		unsigned int pushMany(const T* items, unsigned int count, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			const unsigned int pushed = pushManyBlocking(items, count, max(1, ticks));
+
+			if (!pushed && count) {
+				recordPushTimeout();
+			}
+
+			return pushed;
+		}
+
+		unsigned int pushMany(const T* items, unsigned int count, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const unsigned int pushed = pushManyBlocking(items, count, max(1, ticks));
+
+			if (pushed) {
+				remainder = 0;
+			} else if (count) {
+				recordPushTimeout();
+			}
+
+			return pushed;
+		}
+
+		void preparePushFromInterrupt()
+		{
+			higher_priority_task_woken_from_push = 0;
+		}
+
+		bool pushFromInterrupt(const T& item)
+		{
+			return pushFromIsr(item, false, &higher_priority_task_woken_from_push);
+		}
+
+		bool pushFromInterrupt(IsrScope& scope, const T& item)
+		{
+			return pushFromIsr(item, false, scope.getHigherPriorityTaskWoken());
+		}
+
+		bool pushFrontFromInterrupt(const T& item)
+		{
+			return pushFromIsr(item, true, &higher_priority_task_woken_from_push);
+		}
+
+		bool pushFrontFromInterrupt(IsrScope& scope, const T& item)
+		{
+			return pushFromIsr(item, true, scope.getHigherPriorityTaskWoken());
+		}
+
+		unsigned int pushManyFromInterrupt(const T* items, unsigned int count)
+		{
+			return pushManyFromIsr(items, count, &higher_priority_task_woken_from_push);
+		}
+
+		unsigned int pushManyFromInterrupt(IsrScope& scope, const T* items, unsigned int count)
+		{
+			return pushManyFromIsr(items, count, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizePushFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken_from_push) {
+				detail::yieldFromIsr();
+			}
+		}
+
+		void pop(T& item)
+		{
+			xQueueReceive(handle, &item, portMAX_DELAY);
+		}
+
+		bool pop(T& item, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			if (xQueueReceive(handle, &item, max(1, ticks)) == pdTRUE) {
+				return true;
+			}
+
+			recordPopTimeout();
+			return false;
+		}
+
+		bool pop(T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xQueueReceive(handle, &item, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				return true;
+			}
+
+			recordPopTimeout();
+			return false;
+		}
+
+		unsigned int popMany(T* items, unsigned int max_count)
+		{
+			return popManyBlocking(items, max_count, portMAX_DELAY);
+		}
+
+		unsigned int popMany(T* items, unsigned int max_count, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			const unsigned int popped = popManyBlocking(items, max_count, max(1, ticks));
+
+			if (!popped && max_count) {
+				recordPopTimeout();
+			}
+
+			return popped;
+		}
+
+		unsigned int popMany(T* items, unsigned int max_count, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const unsigned int popped = popManyBlocking(items, max_count, max(1, ticks));
+
+			if (popped) {
+				remainder = 0;
+			} else if (max_count) {
+				recordPopTimeout();
+			}
+
+			return popped;
+		}
+
+		void preparePopFromInterrupt()
+		{
+			higher_priority_task_woken_from_pop = 0;
+		}
+
+		bool popFromInterrupt(T& item)
+		{
+			return xQueueReceiveFromISR(handle, &item, &higher_priority_task_woken_from_pop) == pdTRUE;
+		}
+
+		bool popFromInterrupt(IsrScope& scope, T& item)
+		{
+			return xQueueReceiveFromISR(handle, &item, scope.getHigherPriorityTaskWoken()) == pdTRUE;
+		}
+
+		unsigned int popManyFromInterrupt(T* items, unsigned int max_count)
+		{
+			return popManyFromIsr(items, max_count, &higher_priority_task_woken_from_pop);
+		}
+
+		unsigned int popManyFromInterrupt(IsrScope& scope, T* items, unsigned int max_count)
+		{
+			return popManyFromIsr(items, max_count, scope.getHigherPriorityTaskWoken());
+		}
+
+		bool peekFromInterrupt(T& item) const
+		{
+			return xQueuePeekFromISR(handle, &item) == pdTRUE;
+		}
+
+		bool isEmptyFromInterrupt() const
+		{
+			return xQueueIsQueueEmptyFromISR(handle) != pdFALSE;
+		}
+
+		bool isFullFromInterrupt() const
+		{
+			return xQueueIsQueueFullFromISR(handle) != pdFALSE;
+		}
+
+		void finalizePopFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken_from_pop) {
+				detail::yieldFromIsr();
+			}
+		}
+
+#if FRT_QUEUE_STATS > 0
+		QueueStats getStats() const
+		{
+			return stats.get();
+		}
+
+		void resetStats()
+		{
+			stats.reset();
+		}
+#endif
+
+	private:
+		template<unsigned int EVENTS>
+		friend class QueueSet;
+
+		template<typename U, unsigned int LANE_ITEMS, unsigned int LEVELS>
+		friend class PriorityQueue;
+
+		unsigned int pushManyBlocking(const T* items, unsigned int count, TickType_t ticks)
+		{
+			if (!count || xQueueSend(handle, items, ticks) != pdTRUE) {
+				return 0;
+			}
+
+			unsigned int pushed = 1;
+
+			// Don't let a woken consumer preempt us after every item
+			vTaskSuspendAll();
+			while (pushed < count && xQueueSend(handle, items + pushed, 0) == pdTRUE) {
+				++pushed;
+			}
+			recordPushed();
+			xTaskResumeAll();
+
+			return pushed;
+		}
+
+		unsigned int popManyBlocking(T* items, unsigned int max_count, TickType_t ticks)
+		{
+			if (!max_count || xQueueReceive(handle, items, ticks) != pdTRUE) {
+				return 0;
+			}
+
+			unsigned int popped = 1;
+
+			// Don't let a woken producer preempt us after every item
+			vTaskSuspendAll();
+			while (popped < max_count && xQueueReceive(handle, items + popped, 0) == pdTRUE) {
+				++popped;
+			}
+			xTaskResumeAll();
+
+			return popped;
+		}
+
+		bool pushFromIsr(const T& item, bool front, BaseType_t* higher_priority_task_woken)
+		{
+			const BaseType_t res =
+				front
+					? xQueueSendToFrontFromISR(handle, &item, higher_priority_task_woken)
+					: xQueueSendFromISR(handle, &item, higher_priority_task_woken);
+
+			if (res == pdTRUE) {
+				recordPushedFromInterrupt();
+				return true;
+			}
+
+			recordInterruptPushesFailed(1);
+			return false;
+		}
+
+		unsigned int pushManyFromIsr(const T* items, unsigned int count, BaseType_t* higher_priority_task_woken)
+		{
+			unsigned int pushed = 0;
+
+			while (
+				pushed < count
+				&& xQueueSendFromISR(handle, items + pushed, higher_priority_task_woken) == pdTRUE
+			) {
+				++pushed;
+			}
+
+			if (pushed) {
+				recordPushedFromInterrupt();
+			}
+			if (pushed < count) {
+				recordInterruptPushesFailed(count - pushed);
+			}
+
+			return pushed;
+		}
+
+		unsigned int popManyFromIsr(T* items, unsigned int max_count, BaseType_t* higher_priority_task_woken)
+		{
+			unsigned int popped = 0;
+
+			while (
+				popped < max_count
+				&& xQueueReceiveFromISR(handle, items + popped, higher_priority_task_woken) == pdTRUE
+			) {
+				++popped;
+			}
+
+			return popped;
+		}
+
+		// These compile to nothing without FRT_QUEUE_STATS
+		void recordPushed()
+		{
+#if FRT_QUEUE_STATS > 0
+			stats.pushed(getFillLevel());
+#endif
+		}
+
+		void recordPushedFromInterrupt()
+		{
+#if FRT_QUEUE_STATS > 0
+			stats.pushedFromInterrupt(uxQueueMessagesWaitingFromISR(handle));
+#endif
+		}
+
+		void recordInterruptPushesFailed(unsigned int count)
+		{
+#if FRT_QUEUE_STATS > 0
+			stats.interruptPushesFailed(count);
+#else
+			(void)count;
+#endif
+		}
+
+		void recordPushTimeout()
+		{
+#if FRT_QUEUE_STATS > 0
+			stats.pushTimedOut();
+#endif
+		}
+
+		void recordPopTimeout()
+		{
+#if FRT_QUEUE_STATS > 0
+			stats.popTimedOut();
+#endif
+		}
+
+		QueueHandle_t handle;
+		BaseType_t higher_priority_task_woken_from_push;
+		BaseType_t higher_priority_task_woken_from_pop;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		uint8_t buffer[ITEMS * sizeof(T)];
+		StaticQueue_t state;
+#endif
+#if FRT_QUEUE_STATS > 0
+		detail::QueueStatsRecorder stats;
+#endif
+	};
+
+	template<typename T, unsigned int ITEMS, unsigned int LEVELS = 2>
+	class PriorityQueue final
+	{
+	public:
+		static_assert(LEVELS > 0, "PriorityQueue needs at least one level");
+		static_assert(LEVELS * ITEMS <= static_cast<UBaseType_t>(-1), "LEVELS * ITEMS exceeds the count of a Semaphore");
+
+		PriorityQueue() :
+			available(true)
+		{
+		}
+
+		explicit PriorityQueue(const PriorityQueue& other) = delete;
+		PriorityQueue& operator =(const PriorityQueue& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(PriorityQueue) + detail::getHeapFootprint(LEVELS * (ITEMS * sizeof(T) + sizeof(StaticQueue_t)) + sizeof(StaticSemaphore_t));
+		}
+
+		unsigned int getFillLevel() const
+		{
+			unsigned int res = 0;
+
+			for (const Queue<T, ITEMS>& lane : lanes) {
+				res += lane.getFillLevel();
+			}
+
+			return res;
+		}
+
+		void push(unsigned int level, const T& item)
+		{
+			lanes[clampLevel(level)].push(item);
+			available.post();
+		}
+
+		bool push(unsigned int level, const T& item, unsigned int msecs)
+		{
+			if (!lanes[clampLevel(level)].push(item, msecs)) {
+				return false;
+			}
+
+			available.post();
+			return true;
+		}
+
+		bool push(unsigned int level, const T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			if (!lanes[clampLevel(level)].push(item, msecs, remainder)) {
+				return false;
+			}
+
+			available.post();
+			return true;
+		}
+
+		void preparePushFromInterrupt()
+		{
+			higher_priority_task_woken = 0;
+		}
+
+		bool pushFromInterrupt(unsigned int level, const T& item)
+		{
+			return pushFromIsr(level, item, &higher_priority_task_woken);
+		}
+
+		bool pushFromInterrupt(IsrScope& scope, unsigned int level, const T& item)
+		{
+			return pushFromIsr(level, item, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizePushFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+
+		void pop(T& item)
+		{
+			available.wait();
+			popHighest(item);
+		}
+
+		bool pop(T& item, unsigned int msecs)
+		{
+			if (!available.wait(msecs)) {
+				return false;
+			}
+
+			popHighest(item);
+			return true;
+		}
+
+		bool pop(T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			if (!available.wait(msecs, remainder)) {
+				return false;
+			}
+
+			popHighest(item);
+			return true;
+		}
+
+	private:
+		static unsigned int clampLevel(unsigned int level)
+		{
+			return
+				level < LEVELS
+					? level
+					: LEVELS - 1;
+		}
+
+		bool pushFromIsr(unsigned int level, const T& item, BaseType_t* higher_priority_task_woken)
+		{
+			if (!lanes[clampLevel(level)].pushFromIsr(item, false, higher_priority_task_woken)) {
+				return false;
+			}
+
+			xSemaphoreGiveFromISR(available.handle, higher_priority_task_woken);
+			return true;
+		}
+
+		void popHighest(T& item)
+		{
+			// Each post of available stands for an item, so there is one
+			for (;;) {
+				for (unsigned int level = LEVELS; level--;) {
+					if (xQueueReceive(lanes[level].handle, &item, 0) == pdTRUE) {
+						return;
+					}
+				}
+			}
+		}
+
+		Queue<T, ITEMS> lanes[LEVELS];
+		Semaphore available;
+		BaseType_t higher_priority_task_woken;
+	};
+
+	template<typename T>
+	class Mailbox final
+	{
+	public:
+		Mailbox() :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xQueueCreateStatic(1, sizeof(T), buffer, &state)
+#else
+				xQueueCreate(1, sizeof(T))
+#endif
+			)
+		{
+		}
+
+		~Mailbox()
+		{
+			vQueueDelete(handle);
+		}
+
+		explicit Mailbox(const Mailbox& other) = delete;
+		Mailbox& operator =(const Mailbox& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(Mailbox) + detail::getHeapFootprint(sizeof(T) + sizeof(StaticQueue_t));
+		}
+
+		bool isEmpty() const
+		{
+			return !uxQueueMessagesWaiting(handle);
+		}
+
+		void clear()
+		{
+			xQueueReset(handle);
+		}
+
+		void overwrite(const T& item)
+		{
+			xQueueOverwrite(handle, &item);
+		}
+
+		void prepareOverwriteFromInterrupt()
+		{
+			higher_priority_task_woken = 0;
+		}
+
+		void overwriteFromInterrupt(const T& item)
+		{
+			xQueueOverwriteFromISR(handle, &item, &higher_priority_task_woken);
+		}
+
+		void overwriteFromInterrupt(IsrScope& scope, const T& item)
+		{
+			xQueueOverwriteFromISR(handle, &item, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizeOverwriteFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken) {
+				detail::yieldFromIsr();
+			}
+		}
+
+		void peek(T& item)
+		{
+			xQueuePeek(handle, &item, portMAX_DELAY);
+		}
+
+		bool peek(T& item, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xQueuePeek(handle, &item, max(1, ticks)) == pdTRUE;
+		}
+
+		bool peek(T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xQueuePeek(handle, &item, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		bool peekFromInterrupt(T& item)
+		{
+			return xQueuePeekFromISR(handle, &item) == pdTRUE;
+		}
+
+		void pop(T& item)
+		{
+			xQueueReceive(handle, &item, portMAX_DELAY);
+		}
+
+		bool pop(T& item, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return xQueueReceive(handle, &item, max(1, ticks)) == pdTRUE;
+		}
+
+		bool pop(T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (xQueueReceive(handle, &item, max(1, ticks)) == pdTRUE) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+	private:
+		QueueHandle_t handle;
+		BaseType_t higher_priority_task_woken;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		uint8_t buffer[sizeof(T)];
+		StaticQueue_t state;
+#endif
+	};
+
+#if configUSE_QUEUE_SETS > 0
+	template<unsigned int EVENTS>
+	class QueueSet final
+	{
+	public:
+		QueueSet() :
+			handle(
+#if configSUPPORT_STATIC_ALLOCATION > 0
+				xQueueGenericCreateStatic(EVENTS, sizeof(QueueSetMemberHandle_t), buffer, &state, queueQUEUE_TYPE_SET)
+#else
+				xQueueCreateSet(EVENTS)
+#endif
+			),
+			selected(nullptr)
+		{
+		}
+
+		~QueueSet()
+		{
+			vQueueDelete(handle);
+		}
+
+		explicit QueueSet(const QueueSet& other) = delete;
+		QueueSet& operator =(const QueueSet& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(QueueSet) + detail::getHeapFootprint(EVENTS * sizeof(QueueSetMemberHandle_t) + sizeof(StaticQueue_t));
+		}
+
+		template<typename T, unsigned int ITEMS>
+		bool add(Queue<T, ITEMS>& queue)
+		{
+			return xQueueAddToSet(queue.handle, handle) == pdPASS;
+		}
+
+		bool add(Semaphore& semaphore)
+		{
+			return xQueueAddToSet(semaphore.handle, handle) == pdPASS;
+		}
+
+		template<typename T, unsigned int ITEMS>
+		bool remove(Queue<T, ITEMS>& queue)
+		{
+			return xQueueRemoveFromSet(queue.handle, handle) == pdPASS;
+		}
+
+		bool remove(Semaphore& semaphore)
+		{
+			return xQueueRemoveFromSet(semaphore.handle, handle) == pdPASS;
+		}
+
+		void select()
+		{
+			selected = xQueueSelectFromSet(handle, portMAX_DELAY);
+		}
+
+		bool select(unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			selected = xQueueSelectFromSet(handle, max(1, ticks));
+
+			return selected;
+		}
+
+		bool select(unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			selected = xQueueSelectFromSet(handle, max(1, ticks));
+
+			if (selected) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+		template<typename T, unsigned int ITEMS>
+		bool isSelected(const Queue<T, ITEMS>& queue) const
+		{
+			return selected == queue.handle;
+		}
+
+		bool isSelected(const Semaphore& semaphore) const
+		{
+			return selected == semaphore.handle;
+		}
+
+	private:
+		QueueSetHandle_t handle;
+		QueueSetMemberHandle_t selected;
+#if configSUPPORT_STATIC_ALLOCATION > 0
+		uint8_t buffer[EVENTS * sizeof(QueueSetMemberHandle_t)];
+		StaticQueue_t state;
+#endif
+	};
+#endif
+
+	template<typename T, unsigned int ITEMS>
+	class ZeroCopyQueue final
+	{
+		static_assert(ITEMS <= 256, "ITEMS exceeds the range of the slot index");
+
+	public:
+		ZeroCopyQueue()
+		{
+			for (unsigned int index = 0; index < ITEMS; ++index) {
+				free_slots.push(index);
+			}
+		}
+
+		explicit ZeroCopyQueue(const ZeroCopyQueue& other) = delete;
+		ZeroCopyQueue& operator =(const ZeroCopyQueue& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(ZeroCopyQueue) + detail::getHeapFootprint(2 * (ITEMS + sizeof(StaticQueue_t)));
+		}
+
+		unsigned int getFillLevel() const
+		{
+			return used_slots.getFillLevel();
+		}
+
+		T* beginPush()
+		{
+			uint8_t index;
+			free_slots.pop(index);
+
+			return items + index;
+		}
+
+		T* beginPush(unsigned int msecs)
+		{
+			uint8_t index;
+
+			return
+				free_slots.pop(index, msecs)
+					? items + index
+					: nullptr;
+		}
+
+		T* beginPush(unsigned int msecs, unsigned int& remainder)
+		{
+			uint8_t index;
+
+			return
+				free_slots.pop(index, msecs, remainder)
+					? items + index
+					: nullptr;
+		}
+
+		void commitPush(T* item)
+		{
+			used_slots.push(item - items);
+		}
+
+		const T* beginPop()
+		{
+			uint8_t index;
+			used_slots.pop(index);
+
+			return items + index;
+		}
+
+		const T* beginPop(unsigned int msecs)
+		{
+			uint8_t index;
+
+			return
+				used_slots.pop(index, msecs)
+					? items + index
+					: nullptr;
+		}
+
+		const T* beginPop(unsigned int msecs, unsigned int& remainder)
+		{
+			uint8_t index;
+
+			return
+				used_slots.pop(index, msecs, remainder)
+					? items + index
+					: nullptr;
+		}
+
+		void releasePop(const T* item)
+		{
+			free_slots.push(item - items);
+		}
+
+	private:
+		// Only slot indices travel through the kernel queues, so there
+		// are never more than ITEMS of them and pushing never blocks
+		Queue<uint8_t, ITEMS> free_slots;
+		Queue<uint8_t, ITEMS> used_slots;
+		T items[ITEMS];
+	};
+
+	template<typename T, unsigned int ITEMS>
+	class SpscRing final
+	{
+		static_assert(ITEMS && !(ITEMS & (ITEMS - 1)), "ITEMS must be a power of two");
+		static_assert(ITEMS - 1 <= static_cast<UBaseType_t>(-1) / 2, "ITEMS exceeds the range of UBaseType_t");
+
+	public:
+		SpscRing() :
+			head(0),
+			tail(0),
+			consumer_waiting(false),
+			consumer(nullptr)
+		{
+		}
+
+		explicit SpscRing(const SpscRing& other) = delete;
+		SpscRing& operator =(const SpscRing& other) = delete;
+
+		static constexpr size_t getFootprint()
+		{
+			return sizeof(SpscRing);
+		}
+
+		unsigned int getFillLevel() const
+		{
+			return static_cast<UBaseType_t>(
+				__atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)
+			);
+		}
+
+		bool push(const T& item)
+		{
+			if (!store(item)) {
+				return false;
+			}
+
+			if (isConsumerWaiting()) {
+				// With the scheduler suspended, the consumer can't stop
+				// waiting between taking it and notifying it
+				vTaskSuspendAll();
+				const bool waiting = consumer_waiting;
+				consumer_waiting = false;
+				if (waiting) {
+					xTaskNotify(consumer, 0, eNoAction);
+				}
+				xTaskResumeAll();
+			}
+
+			return true;
+		}
+
+		void preparePushFromInterrupt()
+		{
+			higher_priority_task_woken_from_push = 0;
+		}
+
+		bool pushFromInterrupt(const T& item)
+		{
+			return pushFromIsr(item, &higher_priority_task_woken_from_push);
+		}
+
+		bool pushFromInterrupt(IsrScope& scope, const T& item)
+		{
+			return pushFromIsr(item, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizePushFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken_from_push) {
+				detail::yieldFromIsr();
+			}
+		}
+
+		bool tryPop(T& item)
+		{
+			const UBaseType_t current_tail = tail;
+
+			if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == current_tail) {
+				return false;
+			}
+
+			item = items[current_tail & (ITEMS - 1)];
+			__atomic_store_n(&tail, static_cast<UBaseType_t>(current_tail + 1), __ATOMIC_RELEASE);
+
+			return true;
+		}
+
+		void pop(T& item)
+		{
+			popBlocking(item, portMAX_DELAY);
+		}
+
+		bool pop(T& item, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+
+			return popBlocking(item, max(1, ticks));
+		}
+
+		bool pop(T& item, unsigned int msecs, unsigned int& remainder)
+		{
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			if (popBlocking(item, max(1, ticks))) {
+				remainder = 0;
+				return true;
+			}
+
+			return false;
+		}
+
+	private:
+		bool store(const T& item)
+		{
+			const UBaseType_t current_head = head;
+
+			if (static_cast<UBaseType_t>(current_head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) == ITEMS) {
+				return false;
+			}
+
+			items[current_head & (ITEMS - 1)] = item;
+			__atomic_store_n(&head, static_cast<UBaseType_t>(current_head + 1), __ATOMIC_RELEASE);
+
+			return true;
+		}
+
+		bool isConsumerWaiting() const
+		{
+			// Pairs with the fence in popBlocking(): Either we see the consumer
+			// waiting, or the consumer sees the new head before blocking
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+			return __atomic_load_n(&consumer_waiting, __ATOMIC_ACQUIRE);
+		}
+
+		// Returns false if the producer already took the waiting consumer,
+		// which means it has notified it
+		bool stopWaiting()
+		{
+			taskENTER_CRITICAL();
+			const bool waiting = consumer_waiting;
+			consumer_waiting = false;
+			taskEXIT_CRITICAL();
+
+			return waiting;
+		}
+
+		bool pushFromIsr(const T& item, BaseType_t* higher_priority_task_woken)
+		{
+			if (!store(item)) {
+				return false;
+			}
+
+			if (isConsumerWaiting()) {
+				consumer_waiting = false;
+				xTaskNotifyFromISR(consumer, 0, eNoAction, higher_priority_task_woken);
+			}
+
+			return true;
+		}
+
+		bool popBlocking(T& item, TickType_t ticks)
+		{
+			TimeOut_t timeout;
+			vTaskSetTimeOutState(&timeout);
+
+			bool popped = tryPop(item);
+			bool timed_out = false;
+			bool woken_by_other = false;
+
+			while (!popped && !timed_out) {
+				consumer = xTaskGetCurrentTaskHandle();
+				__atomic_store_n(&consumer_waiting, true, __ATOMIC_RELEASE);
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+				popped = tryPop(item);
+				timed_out = !popped && xTaskCheckForTimeOut(&timeout, &ticks);
+				const bool woken = !popped && !timed_out && xTaskNotifyWait(0, 0, nullptr, ticks) == pdTRUE;
+
+				if (stopWaiting()) {
+					// Still registered, so the producer didn't wake us
+					woken_by_other = woken_by_other || woken;
+				} else if (xTaskNotifyWait(0, 0, nullptr, 0) == pdTRUE && woken) {
+					// The producer notifies only once, so one of the two
+					// wake-ups came from someone else
+					woken_by_other = true;
+				}
+			}
+
+			detail::restoreNotificationState(woken_by_other);
+
+			return popped;
+		}
+
+		UBaseType_t head;
+		UBaseType_t tail;
+		bool consumer_waiting;
+		TaskHandle_t consumer;
+		BaseType_t higher_priority_task_woken_from_push;
+		T items[ITEMS];
+	};
+
+	template<typename T, unsigned int ITEMS>
+	class Pool final
+	{
+	public:
+		static_assert(ITEMS && ITEMS < 0xFFFF, "ITEMS exceeds the range of the block index");
+
+		// Pass these through a Queue instead of copying the payload
+		typedef T* Handle;
 
-		void finalizePostFromInterrupt() __attribute__((always_inline))
+		Pool() :
+			head(0),
+			free_count(ITEMS),
+			min_free_count(ITEMS),
+			failed_alloc_count(0)
 		{
-			if (higher_priority_task_woken) {
-				detail::yieldFromIsr();
+			for (unsigned int i = 0; i < ITEMS - 1; ++i) {
+				next[i] = i + 1;
 			}
+			next[ITEMS - 1] = NONE;
 		}
 
-	protected:
-		void yield()
+		explicit Pool(const Pool& other) = delete;
+		Pool& operator =(const Pool& other) = delete;
+
+		static constexpr size_t getFootprint()
 		{
-			taskYIELD();
+			return sizeof(Pool);
 		}
 
-		void msleep(unsigned int msecs)
+		Handle alloc()
 		{
-			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+			return take();
+#else
+			taskENTER_CRITICAL();
+			const Handle res = take();
+			taskEXIT_CRITICAL();
 
-			vTaskDelay(max(1, ticks));
+			return res;
+#endif
 		}
 
-		void msleep(unsigned int msecs, unsigned int& remainder)
+		Handle allocFromInterrupt()
 		{
-			msecs += remainder;
-			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
-			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+			return take();
+#else
+			const UBaseType_t saved_state = taskENTER_CRITICAL_FROM_ISR();
+			const Handle res = take();
+			taskEXIT_CRITICAL_FROM_ISR(saved_state);
 
-			vTaskDelay(max(1, ticks));
+			return res;
+#endif
 		}
 
-		void wait()
+		void free(Handle item)
 		{
-			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			if (!item) {
+				return;
+			}
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+			give(item);
+#else
+			taskENTER_CRITICAL();
+			give(item);
+			taskEXIT_CRITICAL();
+#endif
 		}
 
-		bool wait(unsigned int msecs)
+		void freeFromInterrupt(Handle item)
 		{
-			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			if (!item) {
+				return;
+			}
 
-			return ulTaskNotifyTake(pdTRUE, max(1, ticks));
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+			give(item);
+#else
+			const UBaseType_t saved_state = taskENTER_CRITICAL_FROM_ISR();
+			give(item);
+			taskEXIT_CRITICAL_FROM_ISR(saved_state);
+#endif
 		}
 
-		bool wait(unsigned int msecs, unsigned int& remainder)
+		unsigned int getFreeCount() const
 		{
-			msecs += remainder;
-			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
-			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
-
-			if (ulTaskNotifyTake(pdTRUE, max(1, ticks))) {
-				remainder = 0;
-				return true;
-			}
+			return readCounter(free_count);
+		}
 
-			return false;
+		unsigned int getMinFreeCount() const
+		{
+			return readCounter(min_free_count);
 		}
 
-		void beginCriticalSection() __attribute__((always_inline))
+		unsigned int getFailedAllocCount() const
 		{
-			taskENTER_CRITICAL();
+			return readCounter(failed_alloc_count);
 		}
 
-		void endCriticalSection() __attribute__((always_inline))
+		void resetStats()
 		{
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+			__atomic_store_n(&min_free_count, getFreeCount(), __ATOMIC_RELAXED);
+			__atomic_store_n(&failed_alloc_count, 0, __ATOMIC_RELAXED);
+#else
+			taskENTER_CRITICAL();
+			min_free_count = free_count;
+			failed_alloc_count = 0;
 			taskEXIT_CRITICAL();
+#endif
 		}
 
 	private:
-		bool stop(bool from_idle_task)
-		{
-			if (!handle) {
-				return false;
-			}
+		static const uint16_t NONE = 0xFFFF;
 
-			taskENTER_CRITICAL();
-			do_stop = true;
-			while (running) {
-				taskEXIT_CRITICAL();
-				if (!from_idle_task) {
-					vTaskDelay(1);
-				} else {
-					taskYIELD();
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+		// Lock-free stack of free blocks. The upper half of head is a tag
+		// bumped on every change, so a block that is taken and given back
+		// in between can't fool the compare and swap (ABA).
+		Handle take()
+		{
+			uint32_t old_head = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+			uint32_t new_head;
+
+			do {
+				const uint16_t index = old_head;
+				if (index == NONE) {
+					__atomic_add_fetch(&failed_alloc_count, 1, __ATOMIC_RELAXED);
+					return nullptr;
 				}
-				taskENTER_CRITICAL();
+
+				new_head = ((old_head + 0x10000) & 0xFFFF0000) | __atomic_load_n(&next[index], __ATOMIC_RELAXED);
+			} while (
+				!__atomic_compare_exchange_n(&head, &old_head, new_head, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+			);
+
+			const unsigned int free_now = __atomic_sub_fetch(&free_count, 1, __ATOMIC_RELAXED);
+			unsigned int min_free = __atomic_load_n(&min_free_count, __ATOMIC_RELAXED);
+			while (
+				free_now < min_free
+				&& !__atomic_compare_exchange_n(&min_free_count, &min_free, free_now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+			) {
 			}
-			taskEXIT_CRITICAL();
 
-			return true;
+			return items + static_cast<uint16_t>(old_head);
 		}
 
-		static void entryPoint(void* data)
+		void give(Handle item)
 		{
-			Task* const self = static_cast<Task*>(data);
-
-			bool do_stop;
+			const uint16_t index = item - items;
+			uint32_t old_head = __atomic_load_n(&head, __ATOMIC_RELAXED);
+			uint32_t new_head;
+
+			do {
+				__atomic_store_n(&next[index], static_cast<uint16_t>(old_head), __ATOMIC_RELAXED);
+				new_head = ((old_head + 0x10000) & 0xFFFF0000) | index;
+			} while (
+				!__atomic_compare_exchange_n(&head, &old_head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+			);
 
-			taskENTER_CRITICAL();
-			self->running = true;
-			do_stop = self->do_stop;
-			taskEXIT_CRITICAL();
+			__atomic_add_fetch(&free_count, 1, __ATOMIC_RELAXED);
+		}
+#else
+		// Without compare and swap (like on AVR) the callers mask
+		// interrupts, which is just as cheap there
+		Handle take()
+		{
+			const uint16_t index = head;
+			if (index == NONE) {
+				++failed_alloc_count;
+				return nullptr;
+			}
 
-			while (!do_stop && static_cast<T*>(self)->run()) {
-				taskENTER_CRITICAL();
-				do_stop = self->do_stop;
-				taskEXIT_CRITICAL();
+			head = next[index];
+			if (--free_count < min_free_count) {
+				min_free_count = free_count;
 			}
 
+			return items + index;
+		}
+
+		void give(Handle item)
+		{
+			const uint16_t index = item - items;
+
+			next[index] = head;
+			head = index;
+			++free_count;
+		}
+#endif
+
+		static unsigned int readCounter(const unsigned int& counter)
+		{
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+			return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+#else
+			// An unsigned int has two bytes on AVR, and there are no
+			// __atomic library calls to read it in one go
 			taskENTER_CRITICAL();
-			self->do_stop = false;
-			self->running = false;
+			const unsigned int res = counter;
 			taskEXIT_CRITICAL();
 
-			const TaskHandle_t handle_copy = self->handle;
-			self->handle = nullptr;
-
-			vTaskDelete(handle_copy);
+			return res;
+#endif
 		}
 
-		volatile bool running;
-		volatile bool do_stop;
-		TaskHandle_t handle;
-		BaseType_t higher_priority_task_woken;
-#if configSUPPORT_STATIC_ALLOCATION > 0
-		StackType_t stack[STACK_SIZE / sizeof(StackType_t)];
-		StaticTask_t state;
+		T items[ITEMS];
+		uint16_t next[ITEMS];
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+		uint32_t head;
+#else
+		uint16_t head;
 #endif
+		unsigned int free_count;
+		unsigned int min_free_count;
+		unsigned int failed_alloc_count;
 	};
 
-	class Mutex final
+	template<unsigned int SIZE>
+	class StreamBuffer final
 	{
 	public:
-		Mutex() :
+		explicit StreamBuffer(size_t trigger_level = 1) :
 			handle(
 #if configSUPPORT_STATIC_ALLOCATION > 0
-				xSemaphoreCreateMutexStatic(&buffer)
+				xStreamBufferCreateStatic(SIZE, trigger_level, buffer, &state)
 #else
-				xSemaphoreCreateMutex()
+				xStreamBufferCreate(SIZE, trigger_level)
 #endif
 			)
 		{
 		}
 
-		~Mutex()
+		~StreamBuffer()
 		{
-			vSemaphoreDelete(handle);
+			vStreamBufferDelete(handle);
 		}
 
-		explicit Mutex(const Mutex& other) = delete;
-		Mutex& operator =(const Mutex& other) = delete;
+		explicit StreamBuffer(const StreamBuffer& other) = delete;
+		StreamBuffer& operator =(const StreamBuffer& other) = delete;
 
-		void lock()
+		static constexpr size_t getFootprint()
 		{
-			xSemaphoreTake(handle, portMAX_DELAY);
+			return sizeof(StreamBuffer) + detail::getHeapFootprint(SIZE + 1 + sizeof(StaticStreamBuffer_t));
 		}
 
-		void unlock()
+		size_t getFillLevel() const
 		{
-			xSemaphoreGive(handle);
+			return xStreamBufferBytesAvailable(handle);
 		}
 
-	private:
-		SemaphoreHandle_t handle;
-#if configSUPPORT_STATIC_ALLOCATION > 0
-		StaticSemaphore_t buffer;
-#endif
-	};
+		size_t getFreeSpace() const
+		{
+			return xStreamBufferSpacesAvailable(handle);
+		}
 
-	class Semaphore final
-	{
-	public:
-		Semaphore(bool counting = false) :
-			handle(
-#if configSUPPORT_STATIC_ALLOCATION > 0
-				counting
-					? xSemaphoreCreateCountingStatic(static_cast<UBaseType_t>(-1), 0, &buffer)
-					: xSemaphoreCreateBinaryStatic(&buffer)
-#else
-				counting
-					? xSemaphoreCreateCounting(static_cast<UBaseType_t>(-1), 0)
-					: xSemaphoreCreateBinary()
-#endif
-			)
+		bool setTriggerLevel(size_t trigger_level)
 		{
+			return xStreamBufferSetTriggerLevel(handle, trigger_level) == pdPASS;
 		}
 
-		~Semaphore()
+		size_t write(const void* data, size_t size)
 		{
-			vSemaphoreDelete(handle);
+			return xStreamBufferSend(handle, data, size, portMAX_DELAY);
 		}
 
-		explicit Semaphore(const Semaphore& other) = delete;
-		Semaphore& operator =(const Semaphore& other) = delete;
+		size_t write(const void* data, size_t size, unsigned int msecs)
+		{
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 
-		void wait()
+			return xStreamBufferSend(handle, data, size, max(1, ticks));
+		}
+
+		size_t write(const void* data, size_t size, unsigned int msecs, unsigned int& remainder)
 		{
-			xSemaphoreTake(handle, portMAX_DELAY);
+			msecs += remainder;
+			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
+			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
+
+			const size_t written = xStreamBufferSend(handle, data, size, max(1, ticks));
+
+			if (written == size) {
+				remainder = 0;
+			}
+
+			return written;
 		}
 
-		bool wait(unsigned int msecs)
+		void prepareWriteFromInterrupt()
+		{
+			higher_priority_task_woken_from_write = 0;
+		}
+
+		size_t writeFromInterrupt(const void* data, size_t size)
+		{
+			return xStreamBufferSendFromISR(handle, data, size, &higher_priority_task_woken_from_write);
+		}
+
+		size_t writeFromInterrupt(IsrScope& scope, const void* data, size_t size)
+		{
+			return xStreamBufferSendFromISR(handle, data, size, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizeWriteFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken_from_write) {
+				detail::yieldFromIsr();
+			}
+		}
+
+		size_t read(void* data, size_t max_size)
+		{
+			return xStreamBufferReceive(handle, data, max_size, portMAX_DELAY);
+		}
+
+		size_t read(void* data, size_t max_size, unsigned int msecs)
 		{
 			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 
-			return xSemaphoreTake(handle, max(1, ticks)) == pdTRUE;
+			return xStreamBufferReceive(handle, data, max_size, max(1, ticks));
 		}
 
-		bool wait(unsigned int msecs, unsigned int& remainder)
+		size_t read(void* data, size_t max_size, unsigned int msecs, unsigned int& remainder)
 		{
 			msecs += remainder;
 			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
 
-			if (xSemaphoreTake(handle, max(1, ticks)) == pdTRUE) {
+			const size_t received = xStreamBufferReceive(handle, data, max_size, max(1, ticks));
+
+			if (received) {
 				remainder = 0;
-				return true;
 			}
 
-			return false;
+			return received;
 		}
 
-		void post()
+		void prepareReadFromInterrupt()
 		{
-			xSemaphoreGive(handle);
+			higher_priority_task_woken_from_read = 0;
 		}
 
-		void preparePostFromInterrupt()
+		size_t readFromInterrupt(void* data, size_t max_size)
 		{
-			higher_priority_task_woken = 0;
+			return xStreamBufferReceiveFromISR(handle, data, max_size, &higher_priority_task_woken_from_read);
 		}
 
-		void postFromInterrupt()
+		size_t readFromInterrupt(IsrScope& scope, void* data, size_t max_size)
 		{
-			xSemaphoreGiveFromISR(handle, &higher_priority_task_woken);
+			return xStreamBufferReceiveFromISR(handle, data, max_size, scope.getHigherPriorityTaskWoken());
 		}
 
-		void finalizePostFromInterrupt() __attribute__((always_inline))
+		void finalizeReadFromInterrupt() __attribute__((always_inline))
 		{
-			if (higher_priority_task_woken) {
+			if (higher_priority_task_woken_from_read) {
 				detail::yieldFromIsr();
 			}
 		}
 
 	private:
-		SemaphoreHandle_t handle;
-		BaseType_t higher_priority_task_woken;
+		StreamBufferHandle_t handle;
+		BaseType_t higher_priority_task_woken_from_write;
+		BaseType_t higher_priority_task_woken_from_read;
 #if configSUPPORT_STATIC_ALLOCATION > 0
-		StaticSemaphore_t buffer;
+		// FreeRTOS needs one byte more to tell full from empty
+		uint8_t buffer[SIZE + 1];
+		StaticStreamBuffer_t state;
 #endif
 	};
 
-	template<typename T, unsigned int ITEMS>
-	class Queue final
+	template<unsigned int SIZE>
+	class MessageBuffer final
 	{
 	public:
-		Queue() :
+		MessageBuffer() :
 			handle(
 #if configSUPPORT_STATIC_ALLOCATION > 0
-				xQueueCreateStatic(ITEMS, sizeof(T), buffer, &state)
+				xMessageBufferCreateStatic(SIZE, buffer, &state)
 #else
-				xQueueCreate(ITEMS, sizeof(T))
+				xMessageBufferCreate(SIZE)
 #endif
 			)
 		{
 		}
 
-		~Queue()
+		~MessageBuffer()
 		{
-			vQueueDelete(handle);
+			vMessageBufferDelete(handle);
 		}
 
-		explicit Queue(const Queue& other) = delete;
-		Queue& operator =(const Queue& other) = delete;
+		explicit MessageBuffer(const MessageBuffer& other) = delete;
+		MessageBuffer& operator =(const MessageBuffer& other) = delete;
 
-		unsigned int getFillLevel() const
+		static constexpr size_t getFootprint()
 		{
-			return ITEMS - uxQueueSpacesAvailable(handle);
+			return sizeof(MessageBuffer) + detail::getHeapFootprint(SIZE + 1 + sizeof(StaticMessageBuffer_t));
 		}
 
-		void push(const T& item)
+		size_t getFreeSpace() const
 		{
-			xQueueSend(handle, &item, portMAX_DELAY);
+			return xMessageBufferSpacesAvailable(handle);
 		}
 
-		bool push(const T& item, unsigned int msecs)
+		bool write(const void* data, size_t size)
+		{
+			return xMessageBufferSend(handle, data, size, portMAX_DELAY) == size;
+		}
+
+		bool write(const void* data, size_t size, unsigned int msecs)
 		{
 			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 
-			return xQueueSend(handle, &item, max(1, ticks)) == pdTRUE;
+			return xMessageBufferSend(handle, data, size, max(1, ticks)) == size;
 		}
 
-		bool push(const T& item, unsigned int msecs, unsigned int& remainder)
+		bool write(const void* data, size_t size, unsigned int msecs, unsigned int& remainder)
 		{
 			msecs += remainder;
 			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
 
-			if (xQueueSend(handle, &item, max(1, ticks)) == pdTRUE) {
+			if (xMessageBufferSend(handle, data, size, max(1, ticks)) == size) {
 				remainder = 0;
 				return true;
 			}
@@ -439,74 +3378,104 @@ namespace frt
 			return false;
 		}
 
-		void preparePushFromInterrupt()
+		void prepareWriteFromInterrupt()
 		{
-			higher_priority_task_woken_from_push = 0;
+			higher_priority_task_woken_from_write = 0;
 		}
 
-		bool pushFromInterrupt(const T& item)
+		bool writeFromInterrupt(const void* data, size_t size)
 		{
-			return xQueueSendFromISR(handle, &item, &higher_priority_task_woken_from_push) == pdTRUE;
+			return xMessageBufferSendFromISR(handle, data, size, &higher_priority_task_woken_from_write) == size;
 		}
 
-		void finalizePushFromInterrupt() __attribute__((always_inline))
+		bool writeFromInterrupt(IsrScope& scope, const void* data, size_t size)
 		{
-			if (higher_priority_task_woken_from_push) {
+			return xMessageBufferSendFromISR(handle, data, size, scope.getHigherPriorityTaskWoken()) == size;
+		}
+
+		void finalizeWriteFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken_from_write) {
 				detail::yieldFromIsr();
 			}
 		}
 
-		void pop(T& item)
+		size_t read(void* data, size_t max_size)
 		{
-			xQueueReceive(handle, &item, portMAX_DELAY);
+			return xMessageBufferReceive(handle, data, max_size, portMAX_DELAY);
 		}
 
-		bool pop(T& item, unsigned int msecs)
+		size_t read(void* data, size_t max_size, unsigned int msecs)
 		{
 			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 
-			return xQueueReceive(handle, &item, max(1, ticks)) == pdTRUE;
+			return xMessageBufferReceive(handle, data, max_size, max(1, ticks));
 		}
 
-		bool pop(T& item, unsigned int msecs, unsigned int& remainder)
+		size_t read(void* data, size_t max_size, unsigned int msecs, unsigned int& remainder)
 		{
 			msecs += remainder;
 			const TickType_t ticks = msecs / portTICK_PERIOD_MS;
 			remainder = msecs % portTICK_PERIOD_MS * static_cast<bool>(ticks);
 
-			if (xQueueReceive(handle, &item, max(1, ticks)) == pdTRUE) {
+			const size_t received = xMessageBufferReceive(handle, data, max_size, max(1, ticks));
+
+			if (received) {
 				remainder = 0;
-				return true;
 			}
 
-			return false;
+			return received;
 		}
 
-		void preparePopFromInterrupt()
+		void prepareReadFromInterrupt()
 		{
-			higher_priority_task_woken_from_pop = 0;
+			higher_priority_task_woken_from_read = 0;
 		}
 
-		bool popFromInterrupt(const T& item)
+		size_t readFromInterrupt(void* data, size_t max_size)
 		{
-			return xQueueReceiveFromISR(handle, &item, &higher_priority_task_woken_from_pop);
+			return xMessageBufferReceiveFromISR(handle, data, max_size, &higher_priority_task_woken_from_read);
 		}
 
-		void finalizePopFromInterrupt() __attribute__((always_inline))
+		size_t readFromInterrupt(IsrScope& scope, void* data, size_t max_size)
 		{
-			if (higher_priority_task_woken_from_pop) {
+			return xMessageBufferReceiveFromISR(handle, data, max_size, scope.getHigherPriorityTaskWoken());
+		}
+
+		void finalizeReadFromInterrupt() __attribute__((always_inline))
+		{
+			if (higher_priority_task_woken_from_read) {
 				detail::yieldFromIsr();
 			}
 		}
 
 	private:
-		QueueHandle_t handle;
-		BaseType_t higher_priority_task_woken_from_push;
-		BaseType_t higher_priority_task_woken_from_pop;
+		MessageBufferHandle_t handle;
+		BaseType_t higher_priority_task_woken_from_write;
+		BaseType_t higher_priority_task_woken_from_read;
 #if configSUPPORT_STATIC_ALLOCATION > 0
-		uint8_t buffer[ITEMS * sizeof(T)];
-		StaticQueue_t state;
+		// FreeRTOS needs one byte more to tell full from empty
+		uint8_t buffer[SIZE + 1];
+		StaticMessageBuffer_t state;
 #endif
 	};
 
+	constexpr size_t getFootprint()
+	{
+		return 0;
+	}
+
+	// Sums the RAM used by frt objects, including what the kernel
+	// allocates for them on the heap
+	template<typename O, typename... OS>
+	constexpr size_t getFootprint(const O&, const OS&... objects)
+	{
+		return O::getFootprint() + getFootprint(objects...);
+	}
+
 }
+
+// Fails the build if the listed frt objects (defined at namespace scope)
+// need more than BUDGET bytes of RAM
+#define FRT_ASSERT_RAM_BUDGET(BUDGET, ...) \
+	static_assert(frt::getFootprint(__VA_ARGS__) <= (BUDGET), "frt objects exceed the RAM budget")